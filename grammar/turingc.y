@@ -6,6 +6,10 @@
 #include <string>
 }
 
+%code provides{
+void yyerror(YYLTYPE*, void*, parse_info*, const char*);
+}
+
 %{
 #include "turingc.parse.h"
 #include "turingc.lex.h"
@@ -15,6 +19,7 @@
 
 %define api.pure
 %define parse.error detailed
+%locations
 %param {void* scanner}
 %parse-param {parse_info* parser}
 
@@ -66,7 +71,7 @@ func_decl_list
 func_decl
     : FUNCTION ID                                   {parser->symtab->enterFunction(*$2);}
      '(' ')' ':' datatype                           {parser->symtab->declareFunction(*$2, $7);}
-     compound_statement                             {$$ = new ASTNode(NodeType::FUNC_DECL, {$9}, $7, *$2); delete $2; parser->symtab->exitFunction();}
+     compound_statement                             {$$ = new ASTNode(NodeType::FUNC_DECL, {$9}, $7, *$2); $$->line = @1.first_line; delete $2; parser->symtab->exitFunction();}
     ;
 
 statement_list
@@ -75,12 +80,12 @@ statement_list
     ;
 
 statement
-    : expr ';'                                      {$$ = new ASTNode(NodeType::EXPR_STAT, {$1});}
+    : expr ';'                                      {$$ = new ASTNode(NodeType::EXPR_STAT, {$1}); $$->line = @1.first_line;}
     | compound_statement                            {$$ = $1;}
-    | IF '(' expr ')' compound_statement            {$$ = new ASTNode(NodeType::IF_STAT, {$3, $5});}
+    | IF '(' expr ')' compound_statement            {$$ = new ASTNode(NodeType::IF_STAT, {$3, $5}); $$->line = @1.first_line;}
     | IF '(' expr ')' compound_statement
-        ELSE compound_statement                     {$$ = new ASTNode(NodeType::IF_ELSE_STAT, {$3, $5, $7});}
-    | WHILE '(' expr ')' compound_statement         {$$ = new ASTNode(NodeType::WHILE_STAT, {$3, $5});}
+        ELSE compound_statement                     {$$ = new ASTNode(NodeType::IF_ELSE_STAT, {$3, $5, $7}); $$->line = @1.first_line;}
+    | WHILE '(' expr ')' compound_statement         {$$ = new ASTNode(NodeType::WHILE_STAT, {$3, $5}); $$->line = @1.first_line;}
     | declare_statement ';'                         {$$ = $1;}
     ;
 
@@ -97,7 +102,9 @@ declare_statement
                                                             delete $2;
                                                             YYERROR;
                                                         } else {
-                                                            $$ = new ASTNode(NodeType::EMPTY, {});
+                                                            size_t symbol = parser->symtab->resolveSymbol(*$2);
+                                                            $$ = new ASTNode(NodeType::DECL_STAT, {}, $1, symbol);
+                                                            $$->line = @2.first_line;
                                                             delete $2;
                                                         }
                                                     }
@@ -107,11 +114,13 @@ declare_statement
                                                             delete $5;
                                                             YYERROR;
                                                         } else {
-                                                            $$ = new ASTNode(NodeType::EMPTY, {});
+                                                            size_t symbol = parser->symtab->resolveSymbol(*$5);
+                                                            $$ = new ASTNode(NodeType::DECL_STAT, {}, $1, symbol);
+                                                            $$->line = @5.first_line;
                                                             delete $5;
                                                         }
                                                     }
-    | declare_init_statement                        {$$ = new ASTNode(NodeType::EXPR_STAT, {$1});}
+    | declare_init_statement                        {$$ = new ASTNode(NodeType::EXPR_STAT, {$1}); $$->line = @1.first_line;}
     ;
 
 declare_init_statement
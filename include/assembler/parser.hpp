@@ -13,6 +13,7 @@ class AssemblyParser {
     private:
         std::istream& input;
         std::unordered_map<std::string, size_t> labels;
+        size_t line_number = 0;
 
         std::string removeComment(const std::string&);
         void parseLine(const std::string&, std::vector<Instr>&);
@@ -2,6 +2,7 @@
 #define _TURINGCOMPILER_BACKEND_INSTR_HPP
 
 #include <iosfwd>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -81,6 +82,35 @@ enum class Opcode {
     XOR16,
     XOR32,
 
+    //Fused memory arithmetic, applying an immediate to a variable in place
+    ADDLOCAL8,
+    ADDLOCAL16,
+    ADDLOCAL32,
+    SUBLOCAL8,
+    SUBLOCAL16,
+    SUBLOCAL32,
+    XORLOCAL8,
+    XORLOCAL16,
+    XORLOCAL32,
+    ADDARG8,
+    ADDARG16,
+    ADDARG32,
+    SUBARG8,
+    SUBARG16,
+    SUBARG32,
+    XORARG8,
+    XORARG16,
+    XORARG32,
+    ADDGLOBAL8,
+    ADDGLOBAL16,
+    ADDGLOBAL32,
+    SUBGLOBAL8,
+    SUBGLOBAL16,
+    SUBGLOBAL32,
+    XORGLOBAL8,
+    XORGLOBAL16,
+    XORGLOBAL32,
+
     //Address support
     IDXSHFT,
 
@@ -88,6 +118,9 @@ enum class Opcode {
     JMP,
     JF,
     JT,
+    JEQLOCAL8,
+    JEQARG8,
+    JEQGLOBAL8,
     CALL,
     RET,
 
@@ -101,11 +134,17 @@ enum class Opcode {
     REJECT
 };
 
+const size_t NUM_OPCODES = static_cast<size_t>(Opcode::REJECT) + 1;
+
 struct Instr {
     Opcode opcode;
     uint64_t integer;
     uint64_t integer2;
+    // Compared byte of the JEQ instructions, which keep the target in integer
+    uint64_t integer3 = 0;
     std::string label;
+    // Source line the instruction was generated from, 0 if unknown
+    size_t line = 0;
 };
 
 const char* opcode_name(Opcode);
@@ -116,5 +155,6 @@ Instr make_instr(Opcode);
 Instr make_instr(Opcode, uint64_t);
 Instr make_instr(Opcode, uint64_t, uint64_t);
 Instr make_instr(Opcode, const std::string&);
+Instr make_instr(Opcode, uint64_t, uint64_t, const std::string&);
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef _TURINGCOMPILER_BACKEND_MINIMIZER_HPP
+#define _TURINGCOMPILER_BACKEND_MINIMIZER_HPP
+
+#include "backend/turingstate.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Partition of [0, n) into sets that can be split by marking elements (Valmari & Lehtinen)
+class RefinablePartition {
+    private:
+        std::vector<size_t> elements;
+        std::vector<size_t> locations;
+        std::vector<size_t> sets;
+        std::vector<size_t> first;
+        std::vector<size_t> past;
+        std::vector<size_t> marked;
+        std::vector<size_t> touched;
+    public:
+        RefinablePartition(const std::vector<size_t>&, size_t);
+
+        size_t numSets() const;
+        size_t setOf(size_t) const;
+        size_t setBegin(size_t) const;
+        size_t setEnd(size_t) const;
+        size_t element(size_t) const;
+
+        void mark(size_t);
+        void split();
+};
+
+class StateMinimizer {
+    private:
+        const TuringMachine& machine;
+
+        std::vector<size_t> labels;
+        std::vector<size_t> tails;
+        std::vector<size_t> heads;
+
+        std::vector<size_t> normalize();
+    public:
+        StateMinimizer(const TuringMachine&);
+
+        TuringMachine run();
+};
+
+#endif
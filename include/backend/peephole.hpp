@@ -0,0 +1,24 @@
+#ifndef _TURINGCOMPILER_BACKEND_PEEPHOLE_HPP
+#define _TURINGCOMPILER_BACKEND_PEEPHOLE_HPP
+
+#include "backend/instr.hpp"
+
+#include <cstddef>
+#include <vector>
+
+class PeepholeOptimizer {
+    private:
+        std::vector<Instr> instrs;
+        std::vector<bool> jump_targets;
+
+        void findJumpTargets();
+        bool isFoldable(size_t, size_t) const;
+        size_t fold(size_t, std::vector<Instr>&) const;
+        bool runPass();
+    public:
+        PeepholeOptimizer(const std::vector<Instr>&);
+
+        std::vector<Instr> run();
+};
+
+#endif
@@ -4,26 +4,103 @@
 #include <cstddef>
 #include <cstdint>
 #include <vector>
+#include <utility>
+#include <map>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "backend/turingstate.hpp"
+#include "stats.hpp"
 
 struct Instr;
+enum class Opcode;
+class BinaryWriter;
+
+// Tape holding the globals when CompilerOptions::global_tape is set
+const size_t GLOBAL_TAPE = 1;
+
+struct CompilerOptions {
+    bool minimize = false;
+    bool prune = false;
+    bool shared_walks = false;
+    size_t threads = 1;
+    bool template_cache = true;
+    // Indexed accesses with at least this many possible indices walk with a counter
+    size_t counter_index = 256;
+    bool global_tape = false;
+    // Record the instruction every state is generated for
+    bool debug_info = false;
+};
+
+struct PendingTransition {
+    uint32_t state;
+    PackedTransition trans;
+};
+
+// States generated for one instruction by a worker, numbered locally. Local states
+// that stand for the entry state of an IP are listed in ip_states. The transitions to
+// relocate are either its own or those of a cached template.
+struct LoweredInstr {
+    std::vector<PackedTransition> def_transitions;
+    std::vector<uint8_t> def_tapes;
+    std::vector<PendingTransition> transitions;
+    std::vector<std::pair<size_t, size_t>> ip_states;
+    std::vector<size_t> mapping;
+    const std::vector<PendingTransition>* source = nullptr;
+};
 
 class TuringCompiler {
     private:
         Instr* instr;
         size_t num_instr;
+        CompilerOptions options;
 
-        std::vector<TuringState> states;
+        size_t state_base = 0;
+        std::vector<PackedTransition> def_transitions;
+        std::vector<uint8_t> state_tapes;
+        std::vector<PendingTransition> transitions;
+        std::unordered_set<size_t> held_states;
+        std::unordered_map<size_t, PackedTransition> held_defaults;
+        std::vector<size_t> released_states;
         std::unordered_map<size_t, size_t> state_map;
         std::vector<size_t> jump_target_ips;
         std::unordered_map<size_t, uint16_t> jump_idx_map;
 
+        size_t shared_load_split;
+        size_t shared_store_find_top;
+        size_t walk_return_state;
+        std::vector<size_t> walk_return_states;
+        size_t num_walk_returns = 0;
+
+        // Lowered instructions by (opcode, integer, integer2), with IPs relative to the instruction
+        using TemplateKey = std::tuple<size_t, uint64_t, uint64_t>;
+        std::map<TemplateKey, LoweredInstr> templates;
+        size_t template_transitions = 0;
+
+        std::vector<OpcodeStats> opcode_stats;
+
+        std::vector<uint32_t> state_ips;
+        uint32_t current_ip = NO_IP;
+
         size_t addState();
+        void setDefault(size_t, const TuringTransition&);
+        void setTape(size_t, size_t);
+        void addTransition(size_t, const TuringTransition&);
         size_t getStateForIP(size_t);
         void analyzeJumps();
         void compileInstr(size_t);
+        void lowerInstr(size_t, LoweredInstr&);
+        bool isTemplateInstr(size_t) const;
+        TemplateKey getTemplateKey(size_t) const;
+        void instantiateTemplate(size_t, const LoweredInstr&, LoweredInstr&);
+        void addTemplate(size_t, LoweredInstr&);
+        void assignStates(size_t, LoweredInstr&);
+        void relocateTransitions(const LoweredInstr&, PendingTransition*);
+        void compileAll(BinaryWriter*);
+        void buildMachine(TuringMachine&);
+        void flushStates(BinaryWriter&);
+        size_t genStartState();
         void genPush(size_t, uint64_t, size_t, size_t);
         void genPop(size_t, size_t, size_t);
         void genDup(size_t, size_t, size_t);
@@ -38,7 +115,27 @@ class TuringCompiler {
         void genLoadInd(size_t, size_t, size_t, size_t, size_t, size_t);
         void genStore(size_t, size_t, size_t, size_t, size_t);
         void genStoreInd(size_t, size_t, size_t, size_t, size_t, size_t);
+        void genCheckIndex(size_t, size_t, size_t);
+        void genMarkIndex(size_t, size_t, size_t);
+        void genUnmarkIndex(size_t, size_t, size_t, bool = false);
+        void genCounterLoadInd(size_t, size_t, size_t, size_t, size_t);
+        void genCounterStoreInd(size_t, size_t, size_t, size_t, size_t);
+        void genGlobalIndex(size_t, size_t);
+        void genGlobalLoad(size_t, size_t, size_t, size_t);
+        void genGlobalStore(size_t, size_t, size_t, size_t);
         void genSetRet(size_t, size_t, size_t);
+        void genSharedWalks();
+        size_t addWalkReturn(size_t);
+        void genWalkToBase(size_t, size_t, size_t, size_t, size_t);
+        bool genSharedLoad(size_t, size_t, size_t, size_t, size_t);
+        bool genSharedStore(size_t, size_t, size_t, size_t, size_t);
+        size_t genFindVariable(size_t, size_t, size_t);
+        size_t genFindGlobal(size_t, size_t);
+        size_t genReturnToMark(size_t);
+        size_t genReturnToGlobalBase(size_t);
+        void genModify(size_t, size_t, size_t, size_t, Opcode, uint64_t);
+        void genUpdate(size_t, size_t, size_t, size_t, size_t, Opcode, uint64_t);
+        void genBranchEqual(size_t, size_t, size_t, uint8_t, size_t, size_t);
 
         void genPush8(size_t, const Instr&);
         void genPush16(size_t, const Instr&);
@@ -107,10 +204,40 @@ class TuringCompiler {
         void genXor8(size_t, const Instr&);
         void genXor16(size_t, const Instr&);
         void genXor32(size_t, const Instr&);
+        void genAddLocal8(size_t, const Instr&);
+        void genAddLocal16(size_t, const Instr&);
+        void genAddLocal32(size_t, const Instr&);
+        void genSubLocal8(size_t, const Instr&);
+        void genSubLocal16(size_t, const Instr&);
+        void genSubLocal32(size_t, const Instr&);
+        void genXorLocal8(size_t, const Instr&);
+        void genXorLocal16(size_t, const Instr&);
+        void genXorLocal32(size_t, const Instr&);
+        void genAddArg8(size_t, const Instr&);
+        void genAddArg16(size_t, const Instr&);
+        void genAddArg32(size_t, const Instr&);
+        void genSubArg8(size_t, const Instr&);
+        void genSubArg16(size_t, const Instr&);
+        void genSubArg32(size_t, const Instr&);
+        void genXorArg8(size_t, const Instr&);
+        void genXorArg16(size_t, const Instr&);
+        void genXorArg32(size_t, const Instr&);
+        void genAddGlobal8(size_t, const Instr&);
+        void genAddGlobal16(size_t, const Instr&);
+        void genAddGlobal32(size_t, const Instr&);
+        void genSubGlobal8(size_t, const Instr&);
+        void genSubGlobal16(size_t, const Instr&);
+        void genSubGlobal32(size_t, const Instr&);
+        void genXorGlobal8(size_t, const Instr&);
+        void genXorGlobal16(size_t, const Instr&);
+        void genXorGlobal32(size_t, const Instr&);
         void genIdxShft(size_t, const Instr&);
         void genJmp(size_t, const Instr&);
         void genJf(size_t, const Instr&);
         void genJt(size_t, const Instr&);
+        void genJeqLocal8(size_t, const Instr&);
+        void genJeqArg8(size_t, const Instr&);
+        void genJeqGlobal8(size_t, const Instr&);
         void genCall(size_t, const Instr&);
         void genRet(size_t, const Instr&);
         void genSetRet8(size_t, const Instr&);
@@ -123,9 +250,13 @@ class TuringCompiler {
 
         const static CallbackPtr GENERATOR_CALLBACKS[];
     public:
-        TuringCompiler(Instr*, size_t);
+        TuringCompiler(Instr*, size_t, const CompilerOptions& = CompilerOptions());
 
         TuringMachine compile();
+        void compile(BinaryWriter&);
+
+        const std::vector<OpcodeStats>& getOpcodeStats() const;
+        const std::vector<uint32_t>& getStateIPs() const;
 };
 
 #endif
@@ -2,8 +2,10 @@
 #define _TURINGCOMPILER_BACKEND_TURINGSTAGE_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <iosfwd>
+#include <span>
 #include <vector>
 
 const size_t TRANS_WILDCARD = std::numeric_limits<size_t>::max();
@@ -11,6 +13,14 @@ const size_t TAPE_BP = 256;
 const size_t TAPE_AP = 257;
 const size_t TAPE_TEMP1 = 258;
 const size_t TAPE_GP = 259;
+const size_t TAPE_TEMP2 = 260;
+const size_t TAPE_SYMBOLS = 261;
+
+const uint16_t PACKED_WILDCARD = 0x3FFF;
+const uint32_t MAX_TAPES = 64;
+const size_t INVALID_STATE = std::numeric_limits<size_t>::max();
+// IP of states that do not belong to a single instruction
+const uint32_t NO_IP = std::numeric_limits<uint32_t>::max();
 
 enum class TuringDirection {
     STAY,
@@ -25,9 +35,20 @@ struct TuringTransition {
     size_t next_state;
 };
 
+// Storage form of a transition, 8 bytes instead of 32
+struct PackedTransition {
+    uint32_t next_state;
+    uint16_t input;
+    uint16_t output : 14;
+    uint16_t dir : 2;
+};
+
+// Each state reads, writes and moves on one tape, tape 0 unless the machine has more
 struct TuringState {
-    std::vector<TuringTransition> transitions;
-    TuringTransition def_transition;
+    uint64_t first_transition;
+    uint32_t num_transitions;
+    PackedTransition def_transition;
+    uint32_t tape;
 };
 
 struct TuringMachine {
@@ -35,8 +56,21 @@ struct TuringMachine {
     size_t accept_state;
     size_t reject_state;
     std::vector<TuringState> states;
+    std::vector<PackedTransition> transitions;
+    // Instruction each state was generated for, only filled in when debug info is wanted
+    std::vector<uint32_t> state_ips;
+
+    std::span<const PackedTransition> getTransitions(size_t) const;
+    size_t getNumTapes() const;
 };
 
+PackedTransition pack_transition(const TuringTransition&);
+TuringTransition unpack_transition(const PackedTransition&);
+
+TuringMachine renumber_machine(const TuringMachine&, const std::vector<size_t>&, size_t);
+TuringMachine remove_unreachable(const TuringMachine&);
+TuringMachine bypass_forwarders(const TuringMachine&);
+
 std::ostream& operator<<(std::ostream&, const TuringDirection&);
 std::ostream& operator<<(std::ostream&, const TuringTransition&);
 
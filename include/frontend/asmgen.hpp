@@ -16,16 +16,23 @@ class AsmGenerator {
         std::unordered_map<std::string, size_t> labels;
         std::vector<Instr> instrs;
 
+        bool superinstructions;
+
         size_t label_offset = 0;
+        size_t line = 0;
 
         void generateGlobals(ASTNode*);
         void generateGlobal(ASTNode*);
         void generateFunctions(ASTNode*);
         void generate(ASTNode*);
+        bool generateUpdate(ASTNode*);
+        Instr generateJumpIfFalse(ASTNode*, const std::string&);
+        bool getVariable(ASTNode*, size_t&, size_t&);
+        void emit(const Instr&);
 
         std::string nextLabelName();
     public:
-        AsmGenerator(ASTNode*, Symtab*);
+        AsmGenerator(ASTNode*, Symtab*, bool = true);
 
         std::vector<Instr> run();
 };
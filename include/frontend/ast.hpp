@@ -14,6 +14,7 @@ enum class NodeType {
     GLOBAL_DECL,
 
     EXPR_STAT,
+    DECL_STAT,
     IF_STAT,
     IF_ELSE_STAT,
     WHILE_STAT,
@@ -51,6 +52,8 @@ struct ASTNode {
     DataType datatype = DataType::INVALID;
     uint64_t integer, integer2;
     std::string str;
+    // Source line of statements and functions, 0 for everything else
+    size_t line = 0;
 
     ASTNode(NodeType, const std::vector<ASTNode*>&);
     ASTNode(NodeType, const std::vector<ASTNode*>&, DataType);
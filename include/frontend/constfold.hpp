@@ -0,0 +1,27 @@
+#ifndef _TURINGCOMPILER_FRONTEND_CONSTFOLD_HPP
+#define _TURINGCOMPILER_FRONTEND_CONSTFOLD_HPP
+
+#include "frontend/ast.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+class ConstantFolder {
+    private:
+        ASTNode* ast;
+        std::unordered_map<uint64_t, uint64_t> known_values;
+
+        bool isConstant(ASTNode*) const;
+        void makeConstant(ASTNode*, uint64_t);
+        void collectAssigned(ASTNode*, std::unordered_set<uint64_t>&);
+        void forgetAssigned(ASTNode*);
+        void foldStatement(ASTNode*);
+        void foldExpr(ASTNode*);
+    public:
+        ConstantFolder(ASTNode*);
+
+        void run();
+};
+
+#endif
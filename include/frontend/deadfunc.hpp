@@ -0,0 +1,25 @@
+#ifndef _TURINGCOMPILER_FRONTEND_DEADFUNC_HPP
+#define _TURINGCOMPILER_FRONTEND_DEADFUNC_HPP
+
+#include "frontend/ast.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class DeadFunctionEliminator {
+    private:
+        ASTNode* ast;
+        std::unordered_map<std::string, ASTNode*> functions;
+        std::unordered_set<std::string> reachable;
+
+        void collectFunctions(ASTNode*);
+        void collectCalls(ASTNode*, std::unordered_set<std::string>&);
+        void removeDead(ASTNode*);
+    public:
+        DeadFunctionEliminator(ASTNode*);
+
+        size_t run();
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _TURINGCOMPILER_FRONTEND_LAYOUT_HPP
+#define _TURINGCOMPILER_FRONTEND_LAYOUT_HPP
+
+#include "frontend/ast.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Symtab;
+
+// Accesses inside one more level of loops count this many times as much
+const uint64_t LOOP_WEIGHT = 8;
+const size_t MAX_LOOP_DEPTH = 16;
+
+// Orders the stack slots of every frame so the most used variables are nearest to
+// their base marker. Accesses are weighted by loop nesting, or by the steps spent on
+// their source line when a line profile is given.
+class FrameLayout {
+    private:
+        ASTNode* root;
+        Symtab* symtab;
+        const std::unordered_map<size_t, uint64_t>* line_steps;
+        std::vector<uint64_t> weights;
+        size_t loop_depth = 0;
+        size_t line = 0;
+
+        void countAccesses(ASTNode*);
+        uint64_t accessWeight() const;
+    public:
+        FrameLayout(ASTNode*, Symtab*, const std::unordered_map<size_t, uint64_t>* = nullptr);
+
+        void run();
+};
+
+std::unordered_map<size_t, uint64_t> read_line_profile(const std::string&);
+
+#endif
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <string>
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 
 const size_t INVALID_SYMBOL = std::numeric_limits<size_t>::max();
@@ -18,6 +19,9 @@ struct SymbolInfo {
     bool is_array;
     size_t array_size;
     size_t stack_offset;
+    std::string function;
+    size_t live_start;
+    size_t live_end;
 };
 
 struct FuncInfo {
@@ -29,11 +33,14 @@ class Symtab {
     private:
         std::vector<SymbolInfo> symb_decls;
         std::vector<std::unordered_map<std::string, size_t>> scopes;
+        std::vector<size_t> scope_starts;
         std::unordered_map<std::string, size_t> function_locals;
+        std::unordered_map<std::string, size_t> function_frames;
         std::unordered_map<std::string, size_t> function_args;
         std::unordered_map<std::string, FuncInfo> func_decls;
 
         std::string current_function;
+        size_t program_point;
     public:
         Symtab();
 
@@ -56,6 +63,9 @@ class Symtab {
         size_t getArraySize(size_t);
         size_t getFunctionLocalSize(const std::string&);
         size_t getGlobalSpaceSize();
+        size_t getNumSymbols() const;
+
+        void layoutFrames(const std::vector<uint64_t>&);
 };
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef _TURINGCOMPILER_OUTPUT_BINARYREADER_HPP
+#define _TURINGCOMPILER_OUTPUT_BINARYREADER_HPP
+
+#include "backend/turingstate.hpp"
+
+#include <cstdint>
+#include <iostream>
+
+class BinaryReader {
+    private:
+        std::istream& input;
+
+        template <typename T>
+        T read();
+        uint64_t readVarint();
+        int64_t readSigned();
+        TuringMachine parseV1(uint64_t);
+        TuringMachine parseV2();
+        TuringMachine parseMapped();
+    public:
+        BinaryReader(std::istream&);
+
+        TuringMachine parse();
+};
+
+#endif
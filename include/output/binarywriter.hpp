@@ -2,19 +2,53 @@
 #define _TURINGCOMPILER_OUTPUT_BINARYWRITER_HPP
 
 #include "backend/turingstate.hpp"
+#include "output/mappedmachine.hpp"
 
+#include <cstdint>
 #include <iostream>
+#include <span>
+#include <vector>
+
+// v2 files start with this magic followed by the format version
+const uint32_t MACHINE_MAGIC = 0x484D4354; // "TCMH"
+const uint32_t MACHINE_VERSION = 2;
+
+enum class BinaryFormat {
+    V1,
+    V2,
+    MAPPED
+};
 
 class BinaryWriter {
     private:
         std::ostream& output;
+        BinaryFormat format;
+        std::streampos count_pos;
+        uint64_t num_states;
+        uint64_t num_transitions;
+        uint64_t last_index;
+        MappedHeader mapped_header;
+        std::vector<TuringState> mapped_states;
 
         template <typename T>
         void write(const T&);
+        void writeVarint(uint64_t);
+        void writeSigned(int64_t);
+        void writeStateV1(uint64_t, const PackedTransition&, std::span<const PackedTransition>, uint32_t);
+        void writeStateV2(uint64_t, const PackedTransition&, std::span<const PackedTransition>, uint32_t);
+        void writeStateMapped(uint64_t, const PackedTransition&, std::span<const PackedTransition>, uint32_t);
+        void finishMapped();
     public:
-        BinaryWriter(std::ostream&);
+        BinaryWriter(std::ostream&, BinaryFormat = BinaryFormat::V2);
+
+        void begin(uint64_t, uint64_t, uint64_t);
+        void acceptState(uint64_t, const PackedTransition&, std::span<const PackedTransition>, uint32_t = 0);
+        void finish();
 
         void accept(const TuringMachine&);
+
+        uint64_t getNumStates() const;
+        uint64_t getNumTransitions() const;
 };
 
 template <typename T>
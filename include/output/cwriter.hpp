@@ -0,0 +1,28 @@
+#ifndef _TURINGCOMPILER_OUTPUT_CWRITER_HPP
+#define _TURINGCOMPILER_OUTPUT_CWRITER_HPP
+
+#include "backend/turingstate.hpp"
+
+#include <iostream>
+#include <string>
+
+// Translates a machine to a standalone C program. Every state becomes a label with
+// a switch over the symbol under its head, and the program takes the same tape file,
+// --max-steps= and --dump-tape arguments as the runner.
+class CWriter {
+    private:
+        std::ostream& output;
+
+        void writePrologue(const TuringMachine&);
+        void writeState(const TuringMachine&, size_t);
+        void writeAction(size_t, const TuringTransition&, size_t);
+        void writeEpilogue(const TuringMachine&);
+    public:
+        CWriter(std::ostream&);
+
+        void accept(const TuringMachine&);
+};
+
+void compile_c_source(const std::string&, const std::string&);
+
+#endif
\ No newline at end of file
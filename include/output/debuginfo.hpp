@@ -0,0 +1,34 @@
+#ifndef _TURINGCOMPILER_OUTPUT_DEBUGINFO_HPP
+#define _TURINGCOMPILER_OUTPUT_DEBUGINFO_HPP
+
+#include "backend/instr.hpp"
+#include "backend/turingstate.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Debug files start with this magic followed by the format version
+const uint32_t DEBUG_MAGIC = 0x47424454; // "TDBG"
+const uint32_t DEBUG_VERSION = 2;
+
+struct DebugInstr {
+    Opcode opcode;
+    uint32_t line;
+};
+
+// Maps the states of a machine back to the instructions and source lines they were
+// generated for. It is written next to the machine file, with ".dbg" appended.
+struct DebugInfo {
+    std::string source;
+    std::vector<DebugInstr> instrs;
+    std::vector<uint32_t> state_ips;
+};
+
+DebugInfo make_debug_info(const std::string&, const std::vector<Instr>&, const std::vector<uint32_t>&);
+std::string debug_info_path(const std::string&);
+void write_debug_info(const std::string&, const DebugInfo&);
+DebugInfo read_debug_info(const std::string&);
+
+#endif
\ No newline at end of file
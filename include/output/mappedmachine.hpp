@@ -0,0 +1,56 @@
+#ifndef _TURINGCOMPILER_OUTPUT_MAPPEDMACHINE_HPP
+#define _TURINGCOMPILER_OUTPUT_MAPPEDMACHINE_HPP
+
+#include "backend/turingstate.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+const uint32_t MAPPED_VERSION = 4;
+
+// Fixed layout of a mapped machine file. The header is followed by the transition
+// arena and the state table, both stored exactly as they are laid out in memory.
+// Transitions of a state are sorted by input with shadowed duplicates removed.
+struct MappedHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t start_state;
+    uint64_t accept_state;
+    uint64_t reject_state;
+    uint64_t num_states;
+    uint64_t num_transitions;
+    uint64_t transitions_offset;
+    uint64_t states_offset;
+};
+
+class MappedMachine {
+    private:
+        void* data;
+        size_t size;
+        const MappedHeader* header;
+        const TuringState* states;
+        const PackedTransition* transitions;
+        size_t num_tapes;
+    public:
+        MappedMachine(const std::string&);
+        MappedMachine(const MappedMachine&) = delete;
+        ~MappedMachine();
+
+        MappedMachine& operator=(const MappedMachine&) = delete;
+
+        size_t getStartState() const;
+        size_t getAcceptState() const;
+        size_t getRejectState() const;
+        size_t getNumStates() const;
+        size_t getNumTapes() const;
+
+        const TuringState* getStates() const;
+        const PackedTransition* getTransitionArena() const;
+        std::span<const PackedTransition> getTransitions(size_t) const;
+
+        static bool isMapped(const std::string&);
+};
+
+#endif
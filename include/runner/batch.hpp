@@ -0,0 +1,21 @@
+#ifndef _TURINGCOMPILER_RUNNER_BATCH_HPP
+#define _TURINGCOMPILER_RUNNER_BATCH_HPP
+
+#include "runner/simulator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct BatchResult {
+    SimulationResult result;
+    uint64_t steps;
+};
+
+std::vector<std::string> read_batch_inputs(const std::string&);
+std::vector<BatchResult> run_batch(const TuringSimulator&, const std::vector<std::string>&, size_t, uint64_t);
+void write_batch_results(std::ostream&, const std::vector<std::string>&, const std::vector<BatchResult>&);
+
+#endif
\ No newline at end of file
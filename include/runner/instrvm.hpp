@@ -0,0 +1,65 @@
+#ifndef _TURINGCOMPILER_RUNNER_INSTRVM_HPP
+#define _TURINGCOMPILER_RUNNER_INSTRVM_HPP
+
+#include "backend/instr.hpp"
+#include "runner/simulator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class StepResult {
+    NEXT,
+    ACCEPT,
+    REJECT,
+    // The compiled machine would walk left forever looking for a marker
+    HANG
+};
+
+// Runs instructions directly on the tape layout of doc/callingconv.txt, with every
+// instruction leaving the tape as its default lowering in TuringCompiler does. Steps
+// count instructions rather than machine transitions.
+class InstrVM {
+    private:
+        const Instr* instr;
+        size_t num_instr;
+        std::vector<size_t> return_ips;
+        std::vector<size_t> return_ids;
+
+        std::vector<uint16_t> tape;
+        size_t head;
+        size_t ip;
+        uint64_t steps;
+
+        uint16_t& cell(size_t);
+        size_t left(size_t, size_t);
+        size_t findMarker(size_t, size_t);
+        bool readByte(size_t, uint8_t&);
+        bool readValue(size_t, size_t, uint32_t&);
+        void writeValue(size_t, size_t, uint32_t);
+
+        StepResult execLoad(size_t, size_t, size_t);
+        StepResult execStore(size_t, size_t, size_t);
+        StepResult popIndex(size_t, size_t&);
+        StepResult execBinary(Opcode, size_t);
+        StepResult findVariable(size_t, size_t, size_t&);
+        StepResult execUpdate(Opcode, size_t, size_t, size_t, uint32_t);
+        StepResult execCall(size_t);
+        StepResult execRet();
+        StepResult execSetRet(size_t);
+        StepResult exec(const Instr&);
+    public:
+        InstrVM(const Instr*, size_t);
+
+        void reset(const std::vector<uint8_t>&);
+        SimulationResult run(uint64_t);
+
+        uint64_t getSteps() const;
+        size_t getHead() const;
+        const std::vector<uint16_t>& getTape() const;
+};
+
+int run_instrs(const std::vector<Instr>&, const std::string&, uint64_t, bool);
+
+#endif
\ No newline at end of file
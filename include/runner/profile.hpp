@@ -0,0 +1,17 @@
+#ifndef _TURINGCOMPILER_RUNNER_PROFILE_HPP
+#define _TURINGCOMPILER_RUNNER_PROFILE_HPP
+
+#include "output/debuginfo.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <vector>
+
+std::vector<uint64_t> profile_ips(const DebugInfo&, const std::vector<uint64_t>&);
+std::map<size_t, uint64_t> profile_lines(const DebugInfo&, const std::vector<uint64_t>&);
+void print_profile(std::ostream&, const DebugInfo&, const std::vector<uint64_t>&, size_t);
+void write_line_profile(std::ostream&, const DebugInfo&, const std::vector<uint64_t>&);
+
+#endif
\ No newline at end of file
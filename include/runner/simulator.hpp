@@ -0,0 +1,121 @@
+#ifndef _TURINGCOMPILER_RUNNER_SIMULATOR_HPP
+#define _TURINGCOMPILER_RUNNER_SIMULATOR_HPP
+
+#include "backend/turingstate.hpp"
+#include "output/mappedmachine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+const size_t MAX_SCAN_STOPS = 4;
+
+struct SimulatorOptions {
+    bool fuse = true;
+    bool scan = true;
+    // Count the steps taken in every state, single stepping the whole run
+    bool profile = false;
+};
+
+struct JumpEntry {
+    uint32_t next_state;
+    uint16_t output;
+    int16_t move;
+};
+
+// A chain of states that all ignore the symbol under the head, run as a single step.
+// A length of 0 means the state does not start a chain.
+struct MacroStep {
+    uint32_t next_state;
+    uint32_t length;
+    int32_t move;
+    int32_t min_offset;
+    int32_t max_offset;
+    uint32_t first_run;
+    uint32_t num_runs;
+};
+
+// Symbols a macro step leaves on consecutive cells, starting at offset from the head
+struct MacroRun {
+    int32_t offset;
+    uint32_t first_symbol;
+    uint32_t length;
+};
+
+// A state that moves over everything except a few stop symbols without changing the
+// tape, run as a scan for the next stop symbol. No stops means the state is not a scan.
+struct ScanLoop {
+    uint16_t stops[MAX_SCAN_STOPS];
+    uint8_t num_stops;
+    int8_t move;
+};
+
+enum class SimulationResult {
+    ACCEPT,
+    REJECT,
+    TIMEOUT
+};
+
+// Everything derived from the machine when it is loaded. It is never changed after
+// that, so copies of a simulator share it and only keep their own tapes.
+struct SimulatorTables {
+    std::vector<JumpEntry> table;
+    std::vector<uint8_t> state_tapes;
+    std::vector<MacroStep> macros;
+    std::vector<MacroRun> macro_runs;
+    std::vector<uint16_t> macro_symbols;
+    std::vector<ScanLoop> scans;
+    const MappedMachine* mapped;
+    size_t start_state;
+    size_t accept_state;
+    size_t reject_state;
+    size_t num_states;
+    size_t num_tapes;
+    bool profile;
+};
+
+class TuringSimulator {
+    private:
+        std::shared_ptr<SimulatorTables> tables;
+
+        std::vector<std::vector<uint16_t>> tapes;
+        std::vector<size_t> heads;
+        size_t state;
+        uint64_t steps;
+        std::vector<uint64_t> state_hits;
+
+        void lower(const TuringMachine&);
+        void prepare(const TuringState*, size_t, const PackedTransition*, const SimulatorOptions&);
+        void fuseChains(const TuringState*, size_t, const PackedTransition*);
+        void findScans(const TuringState*, size_t, const PackedTransition*);
+        void growTape(size_t);
+        void applyMacro(const MacroStep&, uint16_t*, size_t&);
+        uint64_t applyScan(const ScanLoop&, const uint16_t*, size_t, size_t&, uint64_t);
+        SimulationResult runTable(uint64_t);
+        SimulationResult runTableMulti(uint64_t);
+        SimulationResult runMapped(uint64_t);
+        SimulationResult runProfiled(uint64_t);
+        SimulationResult finishRun(size_t, uint64_t);
+    public:
+        TuringSimulator(const TuringMachine&, const SimulatorOptions& = {});
+        TuringSimulator(const MappedMachine&, const SimulatorOptions& = {});
+
+        void reset(const std::vector<uint8_t>&);
+        SimulationResult run(uint64_t);
+
+        uint64_t getSteps() const;
+        size_t getNumTapes() const;
+        size_t getHead(size_t = 0) const;
+        const std::vector<uint16_t>& getTape(size_t = 0) const;
+        const std::vector<uint64_t>& getStateHits() const;
+};
+
+std::vector<uint8_t> read_tape_file(const std::string&);
+void print_tape(std::ostream&, const std::vector<uint16_t>&, size_t);
+
+std::ostream& operator<<(std::ostream&, SimulationResult);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _TURINGCOMPILER_STATS_HPP
+#define _TURINGCOMPILER_STATS_HPP
+
+#include "backend/instr.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+struct OpcodeStats {
+    uint64_t instructions = 0;
+    uint64_t states = 0;
+    uint64_t transitions = 0;
+};
+
+struct PhaseStats {
+    std::string name;
+    double seconds;
+    uint64_t peak_rss_kb;
+};
+
+class CompileStats {
+    private:
+        std::vector<PhaseStats> phases;
+        std::string current_phase;
+        std::chrono::steady_clock::time_point phase_start;
+    public:
+        uint64_t num_instrs = 0;
+        uint64_t num_states = 0;
+        uint64_t num_transitions = 0;
+        std::vector<OpcodeStats> opcodes;
+
+        void startPhase(const std::string&);
+        void endPhase();
+
+        void print(std::ostream&) const;
+        void printJson(std::ostream&) const;
+};
+
+uint64_t peak_rss_kb();
+
+#endif
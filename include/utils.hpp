@@ -2,6 +2,7 @@
 #define _TURINGCOMPILER_UTILS_HPP
 
 #include <string>
+#include <cstdint>
 #include <sstream>
 #include <vector>
 
@@ -10,6 +11,7 @@ std::string utils_rtrim(const std::string&);
 std::string utils_trim(const std::string&);
 
 std::vector<std::string> utils_split(const std::string&, char);
+bool utils_parse_uint(const std::string&, uint64_t&);
 
 template <typename... Args>
 std::string utils_make_str(const Args&... args) {
@@ -13,6 +13,7 @@ enum class OperandType {
     CONST16,
     CONST32,
     CONST32_2,
+    CONST32_8_LABEL,
     LABEL
 };
 
@@ -84,10 +85,40 @@ const std::unordered_map<std::string, Opcode> OPCODE_MAP = {
     {"XOR8", Opcode::XOR8},
     {"XOR16", Opcode::XOR16},
     {"XOR32", Opcode::XOR32},
+    {"ADDLOCAL8", Opcode::ADDLOCAL8},
+    {"ADDLOCAL16", Opcode::ADDLOCAL16},
+    {"ADDLOCAL32", Opcode::ADDLOCAL32},
+    {"SUBLOCAL8", Opcode::SUBLOCAL8},
+    {"SUBLOCAL16", Opcode::SUBLOCAL16},
+    {"SUBLOCAL32", Opcode::SUBLOCAL32},
+    {"XORLOCAL8", Opcode::XORLOCAL8},
+    {"XORLOCAL16", Opcode::XORLOCAL16},
+    {"XORLOCAL32", Opcode::XORLOCAL32},
+    {"ADDARG8", Opcode::ADDARG8},
+    {"ADDARG16", Opcode::ADDARG16},
+    {"ADDARG32", Opcode::ADDARG32},
+    {"SUBARG8", Opcode::SUBARG8},
+    {"SUBARG16", Opcode::SUBARG16},
+    {"SUBARG32", Opcode::SUBARG32},
+    {"XORARG8", Opcode::XORARG8},
+    {"XORARG16", Opcode::XORARG16},
+    {"XORARG32", Opcode::XORARG32},
+    {"ADDGLOBAL8", Opcode::ADDGLOBAL8},
+    {"ADDGLOBAL16", Opcode::ADDGLOBAL16},
+    {"ADDGLOBAL32", Opcode::ADDGLOBAL32},
+    {"SUBGLOBAL8", Opcode::SUBGLOBAL8},
+    {"SUBGLOBAL16", Opcode::SUBGLOBAL16},
+    {"SUBGLOBAL32", Opcode::SUBGLOBAL32},
+    {"XORGLOBAL8", Opcode::XORGLOBAL8},
+    {"XORGLOBAL16", Opcode::XORGLOBAL16},
+    {"XORGLOBAL32", Opcode::XORGLOBAL32},
     {"IDXSHFT", Opcode::IDXSHFT},
     {"JMP", Opcode::JMP},
     {"JF", Opcode::JF},
     {"JT", Opcode::JT},
+    {"JEQLOCAL8", Opcode::JEQLOCAL8},
+    {"JEQARG8", Opcode::JEQARG8},
+    {"JEQGLOBAL8", Opcode::JEQGLOBAL8},
     {"CALL", Opcode::CALL},
     {"RET", Opcode::RET},
     {"SETRET8", Opcode::SETRET8},
@@ -165,10 +196,40 @@ const OperandType OPCODE_TYPES[] = {
     OperandType::NONE, //XOR8
     OperandType::NONE, //XOR16
     OperandType::NONE, //XOR32
+    OperandType::CONST32_2, //ADDLOCAL8
+    OperandType::CONST32_2, //ADDLOCAL16
+    OperandType::CONST32_2, //ADDLOCAL32
+    OperandType::CONST32_2, //SUBLOCAL8
+    OperandType::CONST32_2, //SUBLOCAL16
+    OperandType::CONST32_2, //SUBLOCAL32
+    OperandType::CONST32_2, //XORLOCAL8
+    OperandType::CONST32_2, //XORLOCAL16
+    OperandType::CONST32_2, //XORLOCAL32
+    OperandType::CONST32_2, //ADDARG8
+    OperandType::CONST32_2, //ADDARG16
+    OperandType::CONST32_2, //ADDARG32
+    OperandType::CONST32_2, //SUBARG8
+    OperandType::CONST32_2, //SUBARG16
+    OperandType::CONST32_2, //SUBARG32
+    OperandType::CONST32_2, //XORARG8
+    OperandType::CONST32_2, //XORARG16
+    OperandType::CONST32_2, //XORARG32
+    OperandType::CONST32_2, //ADDGLOBAL8
+    OperandType::CONST32_2, //ADDGLOBAL16
+    OperandType::CONST32_2, //ADDGLOBAL32
+    OperandType::CONST32_2, //SUBGLOBAL8
+    OperandType::CONST32_2, //SUBGLOBAL16
+    OperandType::CONST32_2, //SUBGLOBAL32
+    OperandType::CONST32_2, //XORGLOBAL8
+    OperandType::CONST32_2, //XORGLOBAL16
+    OperandType::CONST32_2, //XORGLOBAL32
     OperandType::CONST32, //IDXSHFT
     OperandType::LABEL, //JMP
     OperandType::LABEL, //JF
     OperandType::LABEL, //JT
+    OperandType::CONST32_8_LABEL, //JEQLOCAL8
+    OperandType::CONST32_8_LABEL, //JEQARG8
+    OperandType::CONST32_8_LABEL, //JEQGLOBAL8
     OperandType::LABEL, //CALL
     OperandType::NONE, //RET
     OperandType::NONE, //SETRET8
@@ -220,6 +281,7 @@ void AssemblyParser::parseLine(const std::string& line, std::vector<Instr>& resu
 
     Instr instr;
     instr.opcode = op;
+    instr.line = this->line_number;
 
     switch(op_type) {
         case OperandType::NONE:
@@ -247,6 +309,13 @@ void AssemblyParser::parseLine(const std::string& line, std::vector<Instr>& resu
             instr.integer = this->parseInteger<uint32_t>(operands[0]);
             instr.integer2 = this->parseInteger<uint32_t>(operands[1]);
             break;
+        case OperandType::CONST32_8_LABEL:
+            if(operands.size() != 3)
+                throw ParseException("Wrong number of operands given to opcode ", opcode, ": ", operands.size(), " given, expected 3");
+            instr.integer2 = this->parseInteger<uint32_t>(operands[0]);
+            instr.integer3 = this->parseInteger<uint8_t>(operands[1]);
+            instr.label = operands[2];
+            break;
         case OperandType::LABEL:
             if(operands.size() != 1)
                 throw ParseException("Wrong number of operands given to opcode ", opcode, ": ", operands.size(), " given, expected 1");
@@ -262,6 +331,7 @@ std::vector<Instr> AssemblyParser::parse() {
 
     std::string line;
     while(std::getline(this->input, line)) {
+        ++this->line_number;
         this->parseLine(line, result);
     }
 
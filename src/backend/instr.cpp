@@ -70,10 +70,40 @@ const char* OPCODE_NAMES[] = {
     "XOR8",
     "XOR16",
     "XOR32",
+    "ADDLOCAL8",
+    "ADDLOCAL16",
+    "ADDLOCAL32",
+    "SUBLOCAL8",
+    "SUBLOCAL16",
+    "SUBLOCAL32",
+    "XORLOCAL8",
+    "XORLOCAL16",
+    "XORLOCAL32",
+    "ADDARG8",
+    "ADDARG16",
+    "ADDARG32",
+    "SUBARG8",
+    "SUBARG16",
+    "SUBARG32",
+    "XORARG8",
+    "XORARG16",
+    "XORARG32",
+    "ADDGLOBAL8",
+    "ADDGLOBAL16",
+    "ADDGLOBAL32",
+    "SUBGLOBAL8",
+    "SUBGLOBAL16",
+    "SUBGLOBAL32",
+    "XORGLOBAL8",
+    "XORGLOBAL16",
+    "XORGLOBAL32",
     "IDXSHFT",
     "JMP",
     "JF",
     "JT",
+    "JEQLOCAL8",
+    "JEQARG8",
+    "JEQGLOBAL8",
     "CALL",
     "RET",
     "SETRET8",
@@ -144,8 +174,42 @@ std::ostream& operator<<(std::ostream& os, const Instr& instr) {
         case Opcode::SETGLOBALIND8:
         case Opcode::SETGLOBALIND16:
         case Opcode::SETGLOBALIND32:
+        case Opcode::ADDLOCAL8:
+        case Opcode::ADDLOCAL16:
+        case Opcode::ADDLOCAL32:
+        case Opcode::SUBLOCAL8:
+        case Opcode::SUBLOCAL16:
+        case Opcode::SUBLOCAL32:
+        case Opcode::XORLOCAL8:
+        case Opcode::XORLOCAL16:
+        case Opcode::XORLOCAL32:
+        case Opcode::ADDARG8:
+        case Opcode::ADDARG16:
+        case Opcode::ADDARG32:
+        case Opcode::SUBARG8:
+        case Opcode::SUBARG16:
+        case Opcode::SUBARG32:
+        case Opcode::XORARG8:
+        case Opcode::XORARG16:
+        case Opcode::XORARG32:
+        case Opcode::ADDGLOBAL8:
+        case Opcode::ADDGLOBAL16:
+        case Opcode::ADDGLOBAL32:
+        case Opcode::SUBGLOBAL8:
+        case Opcode::SUBGLOBAL16:
+        case Opcode::SUBGLOBAL32:
+        case Opcode::XORGLOBAL8:
+        case Opcode::XORGLOBAL16:
+        case Opcode::XORGLOBAL32:
             os << " " << instr.integer << ", " << instr.integer2;
             break;
+        case Opcode::JEQLOCAL8:
+        case Opcode::JEQARG8:
+        case Opcode::JEQGLOBAL8:
+            os << " " << instr.integer2 << ", " << instr.integer3 << ", " << instr.integer;
+            if(instr.label.size() > 0)
+                os << " (" << instr.label << ")";
+            break;
         case Opcode::JMP:
         case Opcode::JF:
         case Opcode::JT:
@@ -187,4 +251,14 @@ Instr make_instr(Opcode op, const std::string& str) {
     instr.integer = 0;
     instr.label = str;
     return instr;
+}
+
+Instr make_instr(Opcode op, uint64_t integer2, uint64_t integer3, const std::string& str) {
+    Instr instr;
+    instr.opcode = op;
+    instr.integer = 0;
+    instr.integer2 = integer2;
+    instr.integer3 = integer3;
+    instr.label = str;
+    return instr;
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+#include "backend/minimizer.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+RefinablePartition::RefinablePartition(const std::vector<size_t>& initial_sets, size_t num_sets) {
+    size_t num_elements = initial_sets.size();
+
+    this->elements.resize(num_elements);
+    this->locations.resize(num_elements);
+    this->sets = initial_sets;
+    this->first.assign(num_sets, 0);
+    this->past.assign(num_sets, 0);
+    this->marked.assign(std::max(num_elements, num_sets), 0);
+
+    for(size_t set : initial_sets)
+        ++this->past[set];
+
+    size_t offset = 0;
+    for(size_t i = 0; i < num_sets; ++i) {
+        this->first[i] = offset;
+        offset += this->past[i];
+        this->past[i] = this->first[i];
+    }
+
+    for(size_t i = 0; i < num_elements; ++i) {
+        size_t location = this->past[initial_sets[i]]++;
+        this->elements[location] = i;
+        this->locations[i] = location;
+    }
+}
+
+size_t RefinablePartition::numSets() const {
+    return this->first.size();
+}
+
+size_t RefinablePartition::setOf(size_t element) const {
+    return this->sets[element];
+}
+
+size_t RefinablePartition::setBegin(size_t set) const {
+    return this->first[set];
+}
+
+size_t RefinablePartition::setEnd(size_t set) const {
+    return this->past[set];
+}
+
+size_t RefinablePartition::element(size_t location) const {
+    return this->elements[location];
+}
+
+void RefinablePartition::mark(size_t element) {
+    size_t set = this->sets[element];
+    size_t location = this->locations[element];
+    size_t marked_end = this->first[set] + this->marked[set];
+
+    if(location < marked_end)
+        return;
+
+    this->elements[location] = this->elements[marked_end];
+    this->locations[this->elements[location]] = location;
+    this->elements[marked_end] = element;
+    this->locations[element] = marked_end;
+
+    if(this->marked[set]++ == 0)
+        this->touched.push_back(set);
+}
+
+void RefinablePartition::split() {
+    while(!this->touched.empty()) {
+        size_t set = this->touched.back();
+        this->touched.pop_back();
+
+        size_t marked_end = this->first[set] + this->marked[set];
+        this->marked[set] = 0;
+        if(marked_end == this->past[set])
+            continue;
+
+        // The smaller half becomes the new set
+        size_t new_set = this->first.size();
+        if(marked_end - this->first[set] <= this->past[set] - marked_end) {
+            this->first.push_back(this->first[set]);
+            this->past.push_back(marked_end);
+            this->first[set] = marked_end;
+        }
+        else {
+            this->first.push_back(marked_end);
+            this->past.push_back(this->past[set]);
+            this->past[set] = marked_end;
+        }
+
+        if(this->marked.size() <= new_set)
+            this->marked.resize(new_set + 1, 0);
+
+        for(size_t i = this->first[new_set]; i < this->past[new_set]; ++i)
+            this->sets[this->elements[i]] = new_set;
+    }
+}
+
+StateMinimizer::StateMinimizer(const TuringMachine& machine) : machine(machine) {}
+
+std::vector<size_t> StateMinimizer::normalize() {
+    // Explicit transitions that shadow an earlier one or behave exactly like the
+    // default are dropped, the rest is sorted by input so states can be compared.
+    // Every state is then keyed by its default and explicit transitions without
+    // their targets and by its tape, which forms the initial partition.
+    struct LocalTransition {
+        size_t input;
+        size_t output;
+        TuringDirection dir;
+        size_t next_state;
+    };
+
+    size_t num_states = this->machine.states.size();
+    std::vector<size_t> key_offsets(num_states + 1, 0);
+    std::vector<LocalTransition> keys;
+    std::vector<size_t> seen_inputs(PACKED_WILDCARD, INVALID_STATE);
+
+    for(size_t i = 0; i < num_states; ++i) {
+        TuringTransition def_transition = unpack_transition(this->machine.states[i].def_transition);
+        size_t first_key = keys.size();
+
+        keys.push_back({PACKED_WILDCARD, def_transition.output, def_transition.dir, def_transition.next_state});
+
+        for(const PackedTransition& packed : this->machine.getTransitions(i)) {
+            TuringTransition trans = unpack_transition(packed);
+            size_t output = trans.output == TRANS_WILDCARD ? trans.input : trans.output;
+            size_t def_output = def_transition.output == TRANS_WILDCARD ? trans.input : def_transition.output;
+
+            bool shadowed = seen_inputs[trans.input] == i;
+            seen_inputs[trans.input] = i;
+
+            if(shadowed || (output == def_output && trans.dir == def_transition.dir && trans.next_state == def_transition.next_state))
+                continue;
+
+            keys.push_back({trans.input, output, trans.dir, trans.next_state});
+        }
+
+        std::sort(keys.begin() + first_key + 1, keys.end(), [](const LocalTransition& a, const LocalTransition& b) {
+            return a.input < b.input;
+        });
+        key_offsets[i + 1] = keys.size();
+    }
+
+    for(size_t i = 0; i < num_states; ++i) {
+        for(size_t j = key_offsets[i]; j < key_offsets[i + 1]; ++j) {
+            this->labels.push_back(keys[j].input);
+            this->tails.push_back(i);
+            this->heads.push_back(keys[j].next_state);
+        }
+    }
+
+    auto state_class = [&](size_t state) {
+        if(state == this->machine.accept_state)
+            return 0;
+        if(state == this->machine.reject_state)
+            return 1;
+        return 2;
+    };
+
+    auto key_less = [&](size_t a, size_t b) {
+        if(state_class(a) != state_class(b))
+            return state_class(a) < state_class(b);
+        if(this->machine.states[a].tape != this->machine.states[b].tape)
+            return this->machine.states[a].tape < this->machine.states[b].tape;
+
+        size_t a_size = key_offsets[a + 1] - key_offsets[a];
+        size_t b_size = key_offsets[b + 1] - key_offsets[b];
+        if(a_size != b_size)
+            return a_size < b_size;
+
+        for(size_t i = 0; i < a_size; ++i) {
+            const LocalTransition& ta = keys[key_offsets[a] + i];
+            const LocalTransition& tb = keys[key_offsets[b] + i];
+            if(std::tie(ta.input, ta.output, ta.dir) != std::tie(tb.input, tb.output, tb.dir))
+                return std::tie(ta.input, ta.output, ta.dir) < std::tie(tb.input, tb.output, tb.dir);
+        }
+        return false;
+    };
+
+    std::vector<size_t> order(num_states);
+    for(size_t i = 0; i < num_states; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), key_less);
+
+    // Accept and reject are terminal and must never merge with anything
+    std::vector<size_t> initial_blocks(num_states);
+    size_t num_blocks = 0;
+    for(size_t i = 0; i < num_states; ++i) {
+        bool same = i > 0 && state_class(order[i]) == 2 && !key_less(order[i-1], order[i]);
+        if(!same)
+            ++num_blocks;
+        initial_blocks[order[i]] = num_blocks - 1;
+    }
+
+    return initial_blocks;
+}
+
+TuringMachine StateMinimizer::run() {
+    size_t num_states = this->machine.states.size();
+    std::vector<size_t> initial_blocks = this->normalize();
+    size_t num_blocks = num_states == 0 ? 0 : *std::max_element(initial_blocks.begin(), initial_blocks.end()) + 1;
+
+    RefinablePartition blocks(initial_blocks, num_blocks);
+
+    // Transitions start out grouped by label
+    size_t num_trans = this->labels.size();
+    std::vector<size_t> label_order(num_trans);
+    for(size_t i = 0; i < num_trans; ++i)
+        label_order[i] = i;
+    std::sort(label_order.begin(), label_order.end(), [&](size_t a, size_t b) {
+        return this->labels[a] < this->labels[b];
+    });
+
+    std::vector<size_t> initial_cords(num_trans);
+    size_t num_cords = 0;
+    for(size_t i = 0; i < num_trans; ++i) {
+        if(i == 0 || this->labels[label_order[i-1]] != this->labels[label_order[i]])
+            ++num_cords;
+        initial_cords[label_order[i]] = num_cords - 1;
+    }
+
+    RefinablePartition cords(initial_cords, num_cords);
+
+    std::vector<size_t> incoming_offsets(num_states + 1, 0);
+    std::vector<size_t> incoming(num_trans);
+    for(size_t i = 0; i < num_trans; ++i)
+        ++incoming_offsets[this->heads[i] + 1];
+    for(size_t i = 0; i < num_states; ++i)
+        incoming_offsets[i + 1] += incoming_offsets[i];
+    std::vector<size_t> fill = incoming_offsets;
+    for(size_t i = 0; i < num_trans; ++i)
+        incoming[fill[this->heads[i]]++] = i;
+
+    // Split blocks by the cords entering them and cords by the blocks they enter,
+    // every block except the first acts as a splitter once
+    size_t block = 1;
+    size_t cord = 0;
+    while(cord < cords.numSets()) {
+        for(size_t i = cords.setBegin(cord); i < cords.setEnd(cord); ++i)
+            blocks.mark(this->tails[cords.element(i)]);
+        blocks.split();
+        ++cord;
+
+        while(block < blocks.numSets()) {
+            for(size_t i = blocks.setBegin(block); i < blocks.setEnd(block); ++i) {
+                size_t state = blocks.element(i);
+                for(size_t j = incoming_offsets[state]; j < incoming_offsets[state + 1]; ++j)
+                    cords.mark(incoming[j]);
+            }
+            cords.split();
+            ++block;
+        }
+    }
+
+    // Number the blocks by their lowest state, which keeps accept and reject in place
+    std::vector<size_t> block_ids(blocks.numSets(), INVALID_STATE);
+    std::vector<size_t> mapping(num_states);
+    size_t num_new_states = 0;
+    for(size_t i = 0; i < num_states; ++i) {
+        size_t& id = block_ids[blocks.setOf(i)];
+        if(id == INVALID_STATE)
+            id = num_new_states++;
+        mapping[i] = id;
+    }
+
+    return renumber_machine(this->machine, mapping, num_new_states);
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#include "backend/peephole.hpp"
+
+// Width in bytes of an opcode from a PUSH8/PUSH16/PUSH32 style family, 0 if it is not part of it
+inline size_t family_width(Opcode op, Opcode base) {
+    size_t offset = static_cast<size_t>(op) - static_cast<size_t>(base);
+    return (static_cast<size_t>(op) >= static_cast<size_t>(base) && offset < 3) ? (1 << offset) : 0;
+}
+
+inline size_t set_width(Opcode op) {
+    size_t width = family_width(op, Opcode::SETLOCAL8);
+    if(width == 0)
+        width = family_width(op, Opcode::SETARG8);
+    if(width == 0)
+        width = family_width(op, Opcode::SETGLOBAL8);
+    return width;
+}
+
+PeepholeOptimizer::PeepholeOptimizer(const std::vector<Instr>& instrs) : instrs(instrs) {}
+
+void PeepholeOptimizer::findJumpTargets() {
+    this->jump_targets.assign(this->instrs.size() + 1, false);
+
+    for(size_t i = 0; i < this->instrs.size(); ++i) {
+        const Instr& instr = this->instrs[i];
+        switch(instr.opcode) {
+            case Opcode::CALL:
+                this->jump_targets[i + 1] = true;
+                [[fallthrough]];
+            case Opcode::JMP:
+            case Opcode::JF:
+            case Opcode::JT:
+            case Opcode::JEQLOCAL8:
+            case Opcode::JEQARG8:
+            case Opcode::JEQGLOBAL8:
+                if(instr.integer <= this->instrs.size())
+                    this->jump_targets[instr.integer] = true;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+bool PeepholeOptimizer::isFoldable(size_t ip, size_t length) const {
+    // Control may only enter a folded sequence at its first instruction
+    if(ip + length > this->instrs.size())
+        return false;
+    for(size_t i = ip + 1; i < ip + length; ++i) {
+        if(this->jump_targets[i])
+            return false;
+    }
+    return true;
+}
+
+size_t PeepholeOptimizer::fold(size_t ip, std::vector<Instr>& result) const {
+    const Instr& first = this->instrs[ip];
+
+    // DUPn; SETxn; POPn -> SETxn
+    size_t dup_width = family_width(first.opcode, Opcode::DUP8);
+    if(dup_width > 0 && this->isFoldable(ip, 3)) {
+        const Instr& set = this->instrs[ip + 1];
+        const Instr& pop = this->instrs[ip + 2];
+        if(set_width(set.opcode) == dup_width && family_width(pop.opcode, Opcode::POP8) == dup_width) {
+            result.push_back(set);
+            return 3;
+        }
+    }
+
+    // DUPn; POPn and PUSHn; POPn -> nothing
+    size_t push_width = family_width(first.opcode, Opcode::PUSH8);
+    if((dup_width > 0 || push_width > 0) && this->isFoldable(ip, 2)) {
+        if(family_width(this->instrs[ip + 1].opcode, Opcode::POP8) == dup_width + push_width)
+            return 2;
+    }
+
+    // ALLOC a; FREE b -> ALLOC a-b, FREE b-a or nothing
+    if(first.opcode == Opcode::ALLOC && this->isFoldable(ip, 2) && this->instrs[ip + 1].opcode == Opcode::FREE) {
+        uint64_t alloc_size = first.integer;
+        uint64_t free_size = this->instrs[ip + 1].integer;
+        if(alloc_size > free_size)
+            result.push_back(make_instr(Opcode::ALLOC, alloc_size - free_size));
+        else if(free_size > alloc_size)
+            result.push_back(make_instr(Opcode::FREE, free_size - alloc_size));
+        else
+            return 2;
+        result.back().line = first.line;
+        return 2;
+    }
+
+    return 0;
+}
+
+bool PeepholeOptimizer::runPass() {
+    this->findJumpTargets();
+
+    std::vector<Instr> result;
+    std::vector<size_t> new_ips(this->instrs.size() + 1);
+    bool changed = false;
+
+    for(size_t ip = 0; ip < this->instrs.size();) {
+        new_ips[ip] = result.size();
+
+        size_t folded = this->fold(ip, result);
+        if(folded == 0) {
+            result.push_back(this->instrs[ip]);
+            ++ip;
+        }
+        else {
+            for(size_t i = 1; i < folded; ++i)
+                new_ips[ip + i] = result.size();
+            ip += folded;
+            changed = true;
+        }
+    }
+    new_ips[this->instrs.size()] = result.size();
+
+    // A target inside a removed sequence moves to whatever follows it
+    for(Instr& instr : result) {
+        switch(instr.opcode) {
+            case Opcode::JMP:
+            case Opcode::JF:
+            case Opcode::JT:
+            case Opcode::JEQLOCAL8:
+            case Opcode::JEQARG8:
+            case Opcode::JEQGLOBAL8:
+            case Opcode::CALL:
+                if(instr.integer < new_ips.size())
+                    instr.integer = new_ips[instr.integer];
+                break;
+            default:
+                break;
+        }
+    }
+
+    this->instrs = std::move(result);
+    return changed;
+}
+
+std::vector<Instr> PeepholeOptimizer::run() {
+    while(this->runPass());
+    return this->instrs;
+}
\ No newline at end of file
@@ -1,7 +1,18 @@
 #include "backend/turingcompiler.hpp"
 #include "backend/instr.hpp"
+#include "backend/minimizer.hpp"
+#include "output/binarywriter.hpp"
+#include "exceptions.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <memory>
+#include <thread>
+
+const size_t MAX_WALK_RETURNS = 65536;
+const size_t MAX_TEMPLATE_TRANSITIONS = 1 << 24;
 
 const TuringCompiler::CallbackPtr TuringCompiler::GENERATOR_CALLBACKS[] = {
     TuringCompiler::genPush8,
@@ -71,10 +82,40 @@ const TuringCompiler::CallbackPtr TuringCompiler::GENERATOR_CALLBACKS[] = {
     TuringCompiler::genXor8,
     TuringCompiler::genXor16,
     TuringCompiler::genXor32,
+    TuringCompiler::genAddLocal8,
+    TuringCompiler::genAddLocal16,
+    TuringCompiler::genAddLocal32,
+    TuringCompiler::genSubLocal8,
+    TuringCompiler::genSubLocal16,
+    TuringCompiler::genSubLocal32,
+    TuringCompiler::genXorLocal8,
+    TuringCompiler::genXorLocal16,
+    TuringCompiler::genXorLocal32,
+    TuringCompiler::genAddArg8,
+    TuringCompiler::genAddArg16,
+    TuringCompiler::genAddArg32,
+    TuringCompiler::genSubArg8,
+    TuringCompiler::genSubArg16,
+    TuringCompiler::genSubArg32,
+    TuringCompiler::genXorArg8,
+    TuringCompiler::genXorArg16,
+    TuringCompiler::genXorArg32,
+    TuringCompiler::genAddGlobal8,
+    TuringCompiler::genAddGlobal16,
+    TuringCompiler::genAddGlobal32,
+    TuringCompiler::genSubGlobal8,
+    TuringCompiler::genSubGlobal16,
+    TuringCompiler::genSubGlobal32,
+    TuringCompiler::genXorGlobal8,
+    TuringCompiler::genXorGlobal16,
+    TuringCompiler::genXorGlobal32,
     TuringCompiler::genIdxShft,
     TuringCompiler::genJmp,
     TuringCompiler::genJf,
     TuringCompiler::genJt,
+    TuringCompiler::genJeqLocal8,
+    TuringCompiler::genJeqArg8,
+    TuringCompiler::genJeqGlobal8,
     TuringCompiler::genCall,
     TuringCompiler::genRet,
     TuringCompiler::genSetRet8,
@@ -84,34 +125,61 @@ const TuringCompiler::CallbackPtr TuringCompiler::GENERATOR_CALLBACKS[] = {
     TuringCompiler::genReject
 };
 
-TuringCompiler::TuringCompiler(Instr* instr, size_t num_instr) : instr(instr), num_instr(num_instr) {
+TuringCompiler::TuringCompiler(Instr* instr, size_t num_instr, const CompilerOptions& options) : instr(instr), num_instr(num_instr), options(options) {
     TuringTransition self_trans = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, 0};
 
-    TuringState accept_state;
-    accept_state.def_transition = self_trans;
-    this->states.push_back(accept_state);
+    size_t accept_state = this->addState();
+    this->setDefault(accept_state, self_trans);
 
     self_trans.next_state = 1;
-    TuringState reject_state;
-    reject_state.def_transition = self_trans;
-    this->states.push_back(reject_state);
+    size_t reject_state = this->addState();
+    this->setDefault(reject_state, self_trans);
+
+    this->shared_load_split = INVALID_STATE;
+    this->shared_store_find_top = INVALID_STATE;
+    this->walk_return_state = INVALID_STATE;
+    this->opcode_stats.resize(NUM_OPCODES);
 
     this->analyzeJumps();
 }
 
 size_t TuringCompiler::addState() {
     TuringTransition reject_trans = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, 1};
-    TuringState new_state;
-    new_state.def_transition = reject_trans;
 
-    size_t result = this->states.size();
-    this->states.push_back(new_state);
+    size_t result = this->state_base + this->def_transitions.size();
+    this->def_transitions.push_back(pack_transition(reject_trans));
+    this->state_tapes.push_back(0);
+    if(this->options.debug_info)
+        this->state_ips.push_back(this->current_ip);
     return result;
 }
 
+void TuringCompiler::setTape(size_t state, size_t tape) {
+    // Held states are IP and walk entries, which always work on the stack tape
+    if(state < this->state_base)
+        throw ProgramException("Held state ", state, " cannot change tape");
+    this->state_tapes[state - this->state_base] = tape;
+}
+
+void TuringCompiler::setDefault(size_t state, const TuringTransition& trans) {
+    if(state < this->state_base)
+        this->held_defaults[state] = pack_transition(trans);
+    else
+        this->def_transitions[state - this->state_base] = pack_transition(trans);
+}
+
+void TuringCompiler::addTransition(size_t state, const TuringTransition& trans) {
+    this->transitions.push_back({static_cast<uint32_t>(state), pack_transition(trans)});
+}
+
 size_t TuringCompiler::getStateForIP(size_t ip) {
-    if(this->state_map.count(ip) == 0)
-        this->state_map[ip] = this->addState();
+    if(this->state_map.count(ip) == 0) {
+        size_t state = this->addState();
+        this->state_map[ip] = state;
+        this->held_states.insert(state);
+        if(this->options.debug_info)
+            this->state_ips[state] = ip;
+    }
     return this->state_map[ip];
 }
 
@@ -141,7 +209,7 @@ void TuringCompiler::genPush(size_t start_state, uint64_t integer, size_t bytes,
         size_t trans_state = (i == (bytes - 1) ? next_state : this->addState());
 
         TuringTransition trans = {TRANS_WILDCARD, constant, TuringDirection::RIGHT, trans_state};
-        this->states[current_state].def_transition = trans;
+        this->setDefault(current_state, trans);
         current_state = trans_state;
     }
 }
@@ -152,7 +220,7 @@ void TuringCompiler::genPop(size_t start_state, size_t bytes, size_t next_state)
         size_t trans_state = (i == (bytes - 1) ? next_state : this->addState());
 
         TuringTransition trans = {TRANS_WILDCARD, 0, TuringDirection::LEFT, trans_state};
-        this->states[current_state].def_transition = trans;
+        this->setDefault(current_state, trans);
         current_state = trans_state;
     }
 }
@@ -171,7 +239,7 @@ void TuringCompiler::genSwap(size_t start_state, size_t bytes, size_t final_stat
     for(size_t i = 0; i < bytes; ++i) {
         size_t next_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
         current_state = next_state;
     }
 
@@ -185,18 +253,18 @@ void TuringCompiler::genSwap(size_t start_state, size_t bytes, size_t final_stat
         for(size_t j = 0; j < 256; ++j) {
             size_t next_state = this->addState();
             TuringTransition split_up = {j, j, TuringDirection::LEFT, next_state};
-            this->states[current_state].transitions.push_back(split_up);
+            this->addTransition(current_state, split_up);
 
             for(size_t k = 1; k < (bytes + offset); ++k) {
                 size_t inter_state = this->addState();
                 TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, inter_state};
-                this->states[next_state].def_transition = move_left;
+                this->setDefault(next_state, move_left);
                 next_state = inter_state;
             }
 
             for(size_t k = 0; k < 256; ++k) {
                 TuringTransition write_back = {k, j, TuringDirection::RIGHT, back_states[k]};
-                this->states[next_state].transitions.push_back(write_back);
+                this->addTransition(next_state, write_back);
             }
         }
 
@@ -205,12 +273,12 @@ void TuringCompiler::genSwap(size_t start_state, size_t bytes, size_t final_stat
             for(size_t k = 1; k < (bytes + offset); ++k) {
                 size_t inter_state = this->addState();
                 TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, inter_state};
-                this->states[next_state].def_transition = move_right;
+                this->setDefault(next_state, move_right);
                 next_state = inter_state;
             }
 
             TuringTransition write_back = {TRANS_WILDCARD, j, TuringDirection::RIGHT, merge_state};
-            this->states[next_state].def_transition = write_back;
+            this->setDefault(next_state, write_back);
         }
 
         current_state = merge_state;
@@ -222,24 +290,24 @@ void TuringCompiler::genCopyByte(size_t start_state, size_t offset, size_t next_
     for(size_t i = 0; i < offset; ++i) {
         size_t trans_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, trans_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
         current_state = trans_state;
     }
 
     for(size_t i = 0; i < 256; ++i) {
         size_t inter_state = this->addState();
         TuringTransition switch_trans = {i, TRANS_WILDCARD, TuringDirection::RIGHT, inter_state};
-        this->states[current_state].transitions.push_back(switch_trans);
+        this->addTransition(current_state, switch_trans);
 
         for(size_t j = 1; j < offset; ++j) {
             size_t new_state = this->addState();
             TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, new_state};
-            this->states[inter_state].def_transition = move_right;
+            this->setDefault(inter_state, move_right);
             inter_state = new_state;
         }
 
         TuringTransition write_back = {TRANS_WILDCARD, i, TuringDirection::RIGHT, next_state};
-        this->states[inter_state].def_transition = write_back;
+        this->setDefault(inter_state, write_back);
     }
 }
 
@@ -248,7 +316,7 @@ void TuringCompiler::genAdd(size_t start_state, size_t bytes, size_t next_state)
     for(size_t i = 0; i < bytes; ++i) {
         size_t trans_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, trans_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
         current_state = trans_state;
     }
 
@@ -266,19 +334,19 @@ void TuringCompiler::genAdd(size_t start_state, size_t bytes, size_t next_state)
                 TuringTransition split = {j, 0, TuringDirection::LEFT, trans_state};
 
                 size_t opt_carry_state = k == 0 ? normal_state : carry_state;
-                this->states[opt_carry_state].transitions.push_back(split);
+                this->addTransition(opt_carry_state, split);
 
                 for(size_t l = 1; l < bytes; ++l) {
                     size_t inter_state = this->addState();
                     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, inter_state};
-                    this->states[trans_state].def_transition = move_left;
+                    this->setDefault(trans_state, move_left);
                     trans_state = inter_state;
                 }
 
                 for(size_t l = 0; l < 256; ++l) {
                     size_t inter_state = (j + l + k) >= 256 ? next_carry_state : next_normal_state;
                     TuringTransition write_back = {l, (j + l + k) % 256, TuringDirection::RIGHT, inter_state};
-                    this->states[trans_state].transitions.push_back(write_back);
+                    this->addTransition(trans_state, write_back);
                 }
             }
         }
@@ -288,9 +356,9 @@ void TuringCompiler::genAdd(size_t start_state, size_t bytes, size_t next_state)
                 size_t inter_state_normal = this->addState();
                 size_t inter_state_carry = this->addState();
                 TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, inter_state_normal};
-                this->states[next_normal_state].def_transition = move_right;
+                this->setDefault(next_normal_state, move_right);
                 move_right.next_state = inter_state_carry;
-                this->states[next_carry_state].def_transition = move_right;
+                this->setDefault(next_carry_state, move_right);
                 next_normal_state = inter_state_normal;
                 next_carry_state = inter_state_carry;
             }
@@ -306,7 +374,7 @@ void TuringCompiler::genSub(size_t start_state, size_t bytes, size_t next_state)
     for(size_t i = 0; i < bytes; ++i) {
         size_t trans_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, trans_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
         current_state = trans_state;
     }
 
@@ -324,19 +392,19 @@ void TuringCompiler::genSub(size_t start_state, size_t bytes, size_t next_state)
                 TuringTransition split = {j, 0, TuringDirection::LEFT, trans_state};
 
                 size_t opt_carry_state = k == 0 ? normal_state : carry_state;
-                this->states[opt_carry_state].transitions.push_back(split);
+                this->addTransition(opt_carry_state, split);
 
                 for(size_t l = 1; l < bytes; ++l) {
                     size_t inter_state = this->addState();
                     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, inter_state};
-                    this->states[trans_state].def_transition = move_left;
+                    this->setDefault(trans_state, move_left);
                     trans_state = inter_state;
                 }
 
                 for(size_t l = 0; l < 256; ++l) {
                     size_t inter_state = (l < (j + k)) ? next_carry_state : next_normal_state;
                     TuringTransition write_back = {l, (l - j - k) % 256, TuringDirection::RIGHT, inter_state};
-                    this->states[trans_state].transitions.push_back(write_back);
+                    this->addTransition(trans_state, write_back);
                 }
             }
         }
@@ -346,9 +414,9 @@ void TuringCompiler::genSub(size_t start_state, size_t bytes, size_t next_state)
                 size_t inter_state_normal = this->addState();
                 size_t inter_state_carry = this->addState();
                 TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, inter_state_normal};
-                this->states[next_normal_state].def_transition = move_right;
+                this->setDefault(next_normal_state, move_right);
                 move_right.next_state = inter_state_carry;
-                this->states[next_carry_state].def_transition = move_right;
+                this->setDefault(next_carry_state, move_right);
                 next_normal_state = inter_state_normal;
                 next_carry_state = inter_state_carry;
             }
@@ -362,7 +430,7 @@ void TuringCompiler::genSub(size_t start_state, size_t bytes, size_t next_state)
 void TuringCompiler::genAnd(size_t start_state, size_t bytes, size_t next_state) {
     size_t trans_state = this->addState();
     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, trans_state};
-    this->states[start_state].def_transition = move_left;
+    this->setDefault(start_state, move_left);
 
     for(size_t i = 0; i < bytes; ++i) {
         size_t end_state = (bytes == 1) ? next_state : this->addState();
@@ -370,17 +438,17 @@ void TuringCompiler::genAnd(size_t start_state, size_t bytes, size_t next_state)
         for(size_t j = 0; j < 256; ++j) {
             size_t inter_state = this->addState();
             TuringTransition split_byte = {j, 0, TuringDirection::LEFT, inter_state};
-            this->states[trans_state].transitions.push_back(split_byte);
+            this->addTransition(trans_state, split_byte);
 
             for(size_t k = 1; k < bytes; ++k) {
                 move_left.next_state = this->addState();
-                this->states[inter_state].def_transition = move_left;
+                this->setDefault(inter_state, move_left);
                 inter_state = move_left.next_state;
             }
 
             for(size_t k = 0; k < 256; ++k) {
                 TuringTransition write_back = {k, (j & k), TuringDirection::RIGHT, end_state};
-                this->states[inter_state].transitions.push_back(write_back);
+                this->addTransition(inter_state, write_back);
             }
         }
 
@@ -388,21 +456,21 @@ void TuringCompiler::genAnd(size_t start_state, size_t bytes, size_t next_state)
 
         for(size_t j = 2; j < bytes; ++j) {
             TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, this->addState()};
-            this->states[trans_state].def_transition = move_right;
+            this->setDefault(trans_state, move_right);
             trans_state = move_right.next_state;
         }
     }
 
     if(bytes > 1) {
         TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
-        this->states[trans_state].def_transition = move_right;
+        this->setDefault(trans_state, move_right);
     }
 }
 
 void TuringCompiler::genOr(size_t start_state, size_t bytes, size_t next_state) {
     size_t trans_state = this->addState();
     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, trans_state};
-    this->states[start_state].def_transition = move_left;
+    this->setDefault(start_state, move_left);
 
     for(size_t i = 0; i < bytes; ++i) {
         size_t end_state = (bytes == 1) ? next_state : this->addState();
@@ -410,17 +478,17 @@ void TuringCompiler::genOr(size_t start_state, size_t bytes, size_t next_state)
         for(size_t j = 0; j < 256; ++j) {
             size_t inter_state = this->addState();
             TuringTransition split_byte = {j, 0, TuringDirection::LEFT, inter_state};
-            this->states[trans_state].transitions.push_back(split_byte);
+            this->addTransition(trans_state, split_byte);
 
             for(size_t k = 1; k < bytes; ++k) {
                 move_left.next_state = this->addState();
-                this->states[inter_state].def_transition = move_left;
+                this->setDefault(inter_state, move_left);
                 inter_state = move_left.next_state;
             }
 
             for(size_t k = 0; k < 256; ++k) {
                 TuringTransition write_back = {k, (j | k), TuringDirection::RIGHT, end_state};
-                this->states[inter_state].transitions.push_back(write_back);
+                this->addTransition(inter_state, write_back);
             }
         }
 
@@ -428,21 +496,21 @@ void TuringCompiler::genOr(size_t start_state, size_t bytes, size_t next_state)
 
         for(size_t j = 2; j < bytes; ++j) {
             TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, this->addState()};
-            this->states[trans_state].def_transition = move_right;
+            this->setDefault(trans_state, move_right);
             trans_state = move_right.next_state;
         }
     }
 
     if(bytes > 1) {
         TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
-        this->states[trans_state].def_transition = move_right;
+        this->setDefault(trans_state, move_right);
     }
 }
 
 void TuringCompiler::genXor(size_t start_state, size_t bytes, size_t next_state) {
     size_t trans_state = this->addState();
     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, trans_state};
-    this->states[start_state].def_transition = move_left;
+    this->setDefault(start_state, move_left);
 
     for(size_t i = 0; i < bytes; ++i) {
         size_t end_state = (bytes == 1) ? next_state : this->addState();
@@ -450,17 +518,17 @@ void TuringCompiler::genXor(size_t start_state, size_t bytes, size_t next_state)
         for(size_t j = 0; j < 256; ++j) {
             size_t inter_state = this->addState();
             TuringTransition split_byte = {j, 0, TuringDirection::LEFT, inter_state};
-            this->states[trans_state].transitions.push_back(split_byte);
+            this->addTransition(trans_state, split_byte);
 
             for(size_t k = 1; k < bytes; ++k) {
                 move_left.next_state = this->addState();
-                this->states[inter_state].def_transition = move_left;
+                this->setDefault(inter_state, move_left);
                 inter_state = move_left.next_state;
             }
 
             for(size_t k = 0; k < 256; ++k) {
                 TuringTransition write_back = {k, (j ^ k), TuringDirection::RIGHT, end_state};
-                this->states[inter_state].transitions.push_back(write_back);
+                this->addTransition(inter_state, write_back);
             }
         }
 
@@ -468,50 +536,58 @@ void TuringCompiler::genXor(size_t start_state, size_t bytes, size_t next_state)
 
         for(size_t j = 2; j < bytes; ++j) {
             TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, this->addState()};
-            this->states[trans_state].def_transition = move_right;
+            this->setDefault(trans_state, move_right);
             trans_state = move_right.next_state;
         }
     }
 
     if(bytes > 1) {
         TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
-        this->states[trans_state].def_transition = move_right;
+        this->setDefault(trans_state, move_right);
     }
 }
 
 void TuringCompiler::genLoad(size_t start_state, size_t bytes, size_t end_state, size_t offset, size_t base_token) {
+    if(base_token == TAPE_GP && this->options.global_tape) {
+        this->genGlobalLoad(start_state, bytes, end_state, offset);
+        return;
+    }
+
+    if(this->options.shared_walks && this->genSharedLoad(start_state, bytes, end_state, offset, base_token))
+        return;
+
     size_t current_state = start_state;
     for(size_t j = 0; j < bytes; ++j) {
         size_t writeback_state = (j == (bytes - 1)) ? end_state : this->addState();
         size_t next_state = this->addState();
         TuringTransition write_temp = {TRANS_WILDCARD, TAPE_TEMP1, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = write_temp;
+        this->setDefault(current_state, write_temp);
 
         current_state = next_state;
         next_state = this->addState();
         TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, current_state};
         TuringTransition move_to_base_found = {base_token, base_token, TuringDirection::RIGHT, next_state};
-        this->states[current_state].def_transition = move_to_base_loop;
-        this->states[current_state].transitions.push_back(move_to_base_found);
+        this->setDefault(current_state, move_to_base_loop);
+        this->addTransition(current_state, move_to_base_found);
         current_state = next_state;
 
         for(size_t i = 0; i < (offset + j); ++i) {
             next_state = this->addState();
             TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
-            this->states[current_state].def_transition = move_right;
+            this->setDefault(current_state, move_right);
             current_state = next_state;
         }
 
         for(size_t i = 0; i < 256; ++i) {
             size_t split_state = this->addState();
             TuringTransition split_trans = {i, i, TuringDirection::RIGHT, split_state};
-            this->states[current_state].transitions.push_back(split_trans);
+            this->addTransition(current_state, split_trans);
 
             TuringTransition loop_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, split_state};
-            this->states[split_state].def_transition = loop_right;
+            this->setDefault(split_state, loop_right);
 
             TuringTransition write_back = {TAPE_TEMP1, i, TuringDirection::RIGHT, writeback_state};
-            this->states[split_state].transitions.push_back(write_back);
+            this->addTransition(split_state, write_back);
         }
 
         current_state = writeback_state;
@@ -519,11 +595,27 @@ void TuringCompiler::genLoad(size_t start_state, size_t bytes, size_t end_state,
 }
 
 void TuringCompiler::genLoadInd(size_t start_state, size_t bytes, size_t end_state, size_t base_offset, size_t max_ind, size_t base_token) {
+    if(base_token == TAPE_GP && this->options.global_tape) {
+        size_t checked_state = this->addState();
+        size_t index_state = this->addState();
+        this->genCheckIndex(start_state, max_ind, checked_state);
+        this->genGlobalIndex(checked_state, index_state);
+        this->genGlobalLoad(index_state, bytes, end_state, base_offset);
+        return;
+    }
+
+    if(max_ind >= this->options.counter_index) {
+        size_t checked_state = this->addState();
+        this->genCheckIndex(start_state, max_ind, checked_state);
+        this->genCounterLoadInd(checked_state, bytes, end_state, base_offset, base_token);
+        return;
+    }
+
     std::vector<size_t> state_tables[4];
 
     size_t current_state = this->addState();
     TuringTransition move_left = {TRANS_WILDCARD, 0, TuringDirection::LEFT, current_state};
-    this->states[start_state].def_transition = move_left;
+    this->setDefault(start_state, move_left);
 
     for(size_t i = 0; i < max_ind; ++i) {
         state_tables[3].push_back(this->addState());
@@ -536,7 +628,7 @@ void TuringCompiler::genLoadInd(size_t start_state, size_t bytes, size_t end_sta
 
     for(size_t i = 0; i < state_tables[0].size(); ++i) {
         TuringTransition split_trans = {i, 0, TuringDirection::LEFT, state_tables[0][i]};
-        this->states[current_state].transitions.push_back(split_trans);
+        this->addTransition(current_state, split_trans);
     }
 
     for(size_t i = 0; i < 3; ++i) {
@@ -547,7 +639,7 @@ void TuringCompiler::genLoadInd(size_t start_state, size_t bytes, size_t end_sta
             TuringDirection tape_dir = (i == 2) ? TuringDirection::STAY : TuringDirection::LEFT;
 
             TuringTransition split_trans = {cur_idx, 0, tape_dir, state_tables[i+1][j]};
-            this->states[state_tables[i][last_idx]].transitions.push_back(split_trans);
+            this->addTransition(state_tables[i][last_idx], split_trans);
         }
     }
 
@@ -557,55 +649,79 @@ void TuringCompiler::genLoadInd(size_t start_state, size_t bytes, size_t end_sta
 }
 
 void TuringCompiler::genStore(size_t start_state, size_t bytes, size_t end_state, size_t offset, size_t base_token) {
+    if(base_token == TAPE_GP && this->options.global_tape) {
+        this->genGlobalStore(start_state, bytes, end_state, offset);
+        return;
+    }
+
+    if(this->options.shared_walks && this->genSharedStore(start_state, bytes, end_state, offset, base_token))
+        return;
+
     size_t current_state = start_state;
 
     for(size_t k = 0; k < bytes; ++k) {
         size_t next_iter_state = (k == (bytes - 1)) ? end_state : this->addState();
         size_t next_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, 0, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
 
         current_state = next_state;
         size_t loopback_state = this->addState();
         for(size_t i = 0; i < 256; ++i) {
             size_t split_state = this->addState();
             TuringTransition split_writeback = {i, TAPE_TEMP1, TuringDirection::LEFT, split_state};
-            this->states[current_state].transitions.push_back(split_writeback);
+            this->addTransition(current_state, split_writeback);
 
             TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, split_state};
-            this->states[split_state].def_transition = move_to_base_loop;
+            this->setDefault(split_state, move_to_base_loop);
 
             next_state = this->addState();
             TuringTransition move_to_base_found = {base_token, base_token, TuringDirection::RIGHT, next_state};
-            this->states[split_state].transitions.push_back(move_to_base_found);
+            this->addTransition(split_state, move_to_base_found);
 
             size_t move_pos = offset + (bytes - k - 1);
             for(size_t j = 0; j < move_pos; ++j) {
                 size_t sub_state = this->addState();
                 TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, sub_state};
-                this->states[next_state].def_transition = move_right;
+                this->setDefault(next_state, move_right);
                 next_state = sub_state;
             }
 
             TuringTransition write_back = {TRANS_WILDCARD, i, TuringDirection::RIGHT, loopback_state};
-            this->states[next_state].def_transition = write_back;
+            this->setDefault(next_state, write_back);
         }
 
         TuringTransition loop_to_temp = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, loopback_state};
-        this->states[loopback_state].def_transition = loop_to_temp;
+        this->setDefault(loopback_state, loop_to_temp);
         TuringTransition found_trans = {TAPE_TEMP1, 0, TuringDirection::STAY, next_iter_state};
-        this->states[loopback_state].transitions.push_back(found_trans);
+        this->addTransition(loopback_state, found_trans);
 
         current_state = next_iter_state;
     }
 }
 
 void TuringCompiler::genStoreInd(size_t start_state, size_t bytes, size_t end_state, size_t base_offset, size_t max_ind, size_t base_token) {
+    if(base_token == TAPE_GP && this->options.global_tape) {
+        size_t checked_state = this->addState();
+        size_t index_state = this->addState();
+        this->genCheckIndex(start_state, max_ind, checked_state);
+        this->genGlobalIndex(checked_state, index_state);
+        this->genGlobalStore(index_state, bytes, end_state, base_offset);
+        return;
+    }
+
+    if(max_ind >= this->options.counter_index) {
+        size_t checked_state = this->addState();
+        this->genCheckIndex(start_state, max_ind, checked_state);
+        this->genCounterStoreInd(checked_state, bytes, end_state, base_offset, base_token);
+        return;
+    }
+
     std::vector<size_t> state_tables[4];
 
     size_t current_state = this->addState();
     TuringTransition move_left = {TRANS_WILDCARD, 0, TuringDirection::LEFT, current_state};
-    this->states[start_state].def_transition = move_left;
+    this->setDefault(start_state, move_left);
 
     for(size_t i = 0; i < max_ind; ++i) {
         state_tables[3].push_back(this->addState());
@@ -618,7 +734,7 @@ void TuringCompiler::genStoreInd(size_t start_state, size_t bytes, size_t end_st
 
     for(size_t i = 0; i < state_tables[0].size(); ++i) {
         TuringTransition split_trans = {i, 0, TuringDirection::LEFT, state_tables[0][i]};
-        this->states[current_state].transitions.push_back(split_trans);
+        this->addTransition(current_state, split_trans);
     }
 
     for(size_t i = 0; i < 3; ++i) {
@@ -629,7 +745,7 @@ void TuringCompiler::genStoreInd(size_t start_state, size_t bytes, size_t end_st
             TuringDirection tape_dir = (i == 2) ? TuringDirection::STAY : TuringDirection::LEFT;
 
             TuringTransition split_trans = {cur_idx, 0, tape_dir, state_tables[i+1][j]};
-            this->states[state_tables[i][last_idx]].transitions.push_back(split_trans);
+            this->addTransition(state_tables[i][last_idx], split_trans);
         }
     }
 
@@ -638,47 +754,713 @@ void TuringCompiler::genStoreInd(size_t start_state, size_t bytes, size_t end_st
     }
 }
 
+void TuringCompiler::genMarkIndex(size_t start_state, size_t base_token, size_t done_state) {
+    // Moves a TEMP2 marker from the base token right once per unit of the u32 index on
+    // top of the stack, counting the index down to zero. The cell under the marker is
+    // saved at p + 2 and the stack end is marked with TEMP1 at p + 3, with p the first
+    // free cell. Cells p and p + 1 stay clear for the return ids of the shared walks.
+    // Ends on p with the index cells left as garbage.
+    std::vector<size_t> carried;
+    for(size_t i = 0; i < TAPE_SYMBOLS; ++i) {
+        if(i != TAPE_TEMP1 && i != TAPE_TEMP2)
+            carried.push_back(i);
+    }
+
+    size_t dec_states[5];
+    for(size_t i = 0; i < 4; ++i)
+        dec_states[i] = this->addState();
+    dec_states[4] = done_state;
+
+    // Chain from p + 1 down to the low index byte at p - 4
+    size_t to_counter = dec_states[0];
+    for(size_t i = 0; i < 5; ++i) {
+        size_t next_state = this->addState();
+        TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, to_counter};
+        this->setDefault(next_state, move_left);
+        to_counter = next_state;
+    }
+
+    // Chain from the index bytes up to the saved cell, entered at the distance left to go
+    size_t step_state = this->addState();
+    size_t to_saved[6];
+    to_saved[0] = step_state;
+    for(size_t i = 1; i < 6; ++i) {
+        to_saved[i] = this->addState();
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, to_saved[i - 1]};
+        this->setDefault(to_saved[i], move_right);
+    }
+
+    // Mark the stack end, then the base, and save the base token
+    size_t current_state = start_state;
+    for(size_t i = 0; i < 3; ++i) {
+        size_t next_state = this->addState();
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+
+    size_t find_base = this->addState();
+    size_t find_top = this->addState();
+    size_t save_base = this->addState();
+    TuringTransition write_top = {TRANS_WILDCARD, TAPE_TEMP1, TuringDirection::LEFT, find_base};
+    this->setDefault(current_state, write_top);
+
+    TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, find_base};
+    TuringTransition move_to_base_found = {base_token, TAPE_TEMP2, TuringDirection::RIGHT, find_top};
+    this->setDefault(find_base, move_to_base_loop);
+    this->addTransition(find_base, move_to_base_found);
+
+    TuringTransition move_to_top_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, find_top};
+    TuringTransition move_to_top_found = {TAPE_TEMP1, TAPE_TEMP1, TuringDirection::LEFT, save_base};
+    this->setDefault(find_top, move_to_top_loop);
+    this->addTransition(find_top, move_to_top_found);
+
+    TuringTransition write_saved = {TRANS_WILDCARD, base_token, TuringDirection::LEFT, to_counter};
+    this->setDefault(save_base, write_saved);
+
+    // Decrement the index, a borrow out of the high byte means it was zero
+    for(size_t i = 0; i < 4; ++i) {
+        for(size_t j = 1; j < 256; ++j) {
+            TuringTransition decrement = {j, j - 1, TuringDirection::RIGHT, to_saved[5 - i]};
+            this->addTransition(dec_states[i], decrement);
+        }
+        TuringTransition borrow = {0, 255, TuringDirection::RIGHT, dec_states[i + 1]};
+        this->addTransition(dec_states[i], borrow);
+    }
+
+    // Put the saved symbol back under the marker, move the marker right and save the
+    // symbol it now covers
+    size_t read_next = this->addState();
+    for(size_t symbol : carried) {
+        size_t restore_state = this->addState();
+        TuringTransition split_trans = {symbol, symbol, TuringDirection::LEFT, restore_state};
+        this->addTransition(step_state, split_trans);
+
+        TuringTransition loop_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, restore_state};
+        TuringTransition restore_trans = {TAPE_TEMP2, symbol, TuringDirection::RIGHT, read_next};
+        this->setDefault(restore_state, loop_left);
+        this->addTransition(restore_state, restore_trans);
+    }
+
+    for(size_t symbol : carried) {
+        size_t carry_state = this->addState();
+        size_t save_state = this->addState();
+        TuringTransition split_trans = {symbol, TAPE_TEMP2, TuringDirection::RIGHT, carry_state};
+        this->addTransition(read_next, split_trans);
+
+        TuringTransition loop_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, carry_state};
+        TuringTransition found_top = {TAPE_TEMP1, TAPE_TEMP1, TuringDirection::LEFT, save_state};
+        this->setDefault(carry_state, loop_right);
+        this->addTransition(carry_state, found_top);
+
+        TuringTransition save_trans = {TRANS_WILDCARD, symbol, TuringDirection::LEFT, to_counter};
+        this->setDefault(save_state, save_trans);
+    }
+}
+
+void TuringCompiler::genCheckIndex(size_t start_state, size_t max_ind, size_t end_state) {
+    // Compares the u32 index on top of the stack with max_ind from the high byte down
+    // and rejects unless it is below, so the counting lowerings never walk past the
+    // array. Starts and ends on the first free cell with the index left in place.
+    if(max_ind > UINT32_MAX) {
+        TuringTransition stay = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, end_state};
+        this->setDefault(start_state, stay);
+        return;
+    }
+
+    size_t cmp_states[4];
+    for(size_t i = 0; i < 4; ++i)
+        cmp_states[i] = this->addState();
+
+    TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, cmp_states[0]};
+    this->setDefault(start_state, move_left);
+
+    // After deciding on byte k the head moves k + 1 cells right, back to the first free cell
+    size_t back_states[4];
+    back_states[0] = end_state;
+    for(size_t i = 1; i < 4; ++i) {
+        back_states[i] = this->addState();
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, back_states[i - 1]};
+        this->setDefault(back_states[i], move_right);
+    }
+
+    // Bytes above the limit byte have no transition and end in the reject state
+    for(size_t i = 0; i < 4; ++i) {
+        size_t limit = (max_ind >> (8 * (3 - i))) & 0xFF;
+        for(size_t j = 0; j < limit; ++j) {
+            TuringTransition below = {j, j, TuringDirection::RIGHT, back_states[i]};
+            this->addTransition(cmp_states[i], below);
+        }
+        if(i < 3) {
+            TuringTransition equal = {limit, limit, TuringDirection::LEFT, cmp_states[i + 1]};
+            this->addTransition(cmp_states[i], equal);
+        }
+    }
+}
+
+void TuringCompiler::genUnmarkIndex(size_t start_state, size_t distance, size_t end_state, bool clear_start) {
+    // Starts distance cells left of the saved cell, puts the saved symbol back under
+    // the marker and clears everything from the stack end marker down to the start.
+    // The start itself is cleared too with clear_start, for loads that end below the
+    // index cells and leave their remains in the new first free cell.
+    size_t current_state = start_state;
+    for(size_t i = 0; i < distance; ++i) {
+        size_t next_state = this->addState();
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+
+    size_t find_top = this->addState();
+    for(size_t symbol = 0; symbol < TAPE_SYMBOLS; ++symbol) {
+        if(symbol == TAPE_TEMP1 || symbol == TAPE_TEMP2)
+            continue;
+
+        size_t restore_state = this->addState();
+        TuringTransition split_trans = {symbol, 0, TuringDirection::LEFT, restore_state};
+        this->addTransition(current_state, split_trans);
+
+        TuringTransition loop_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, restore_state};
+        TuringTransition restore_trans = {TAPE_TEMP2, symbol, TuringDirection::RIGHT, find_top};
+        this->setDefault(restore_state, loop_left);
+        this->addTransition(restore_state, restore_trans);
+    }
+
+    current_state = this->addState();
+    TuringTransition move_to_top_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, find_top};
+    TuringTransition move_to_top_found = {TAPE_TEMP1, 0, TuringDirection::LEFT, current_state};
+    this->setDefault(find_top, move_to_top_loop);
+    this->addTransition(find_top, move_to_top_found);
+
+    size_t num_cleared = clear_start ? (distance + 1) : distance;
+    for(size_t i = 0; i < num_cleared; ++i) {
+        size_t next_state = (i == (num_cleared - 1) && !clear_start) ? end_state : this->addState();
+        TuringTransition clear_left = {TRANS_WILDCARD, 0, TuringDirection::LEFT, next_state};
+        this->setDefault(current_state, clear_left);
+        current_state = next_state;
+    }
+
+    if(clear_start) {
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, end_state};
+        this->setDefault(current_state, move_right);
+    }
+}
+
+void TuringCompiler::genCounterLoadInd(size_t start_state, size_t bytes, size_t end_state, size_t base_offset, size_t base_token) {
+    size_t done_state = this->addState();
+    this->genMarkIndex(start_state, base_token, done_state);
+
+    // The index is dropped, the value goes where it started
+    size_t current_state = done_state;
+    for(size_t i = 0; i < 4; ++i) {
+        size_t next_state = this->addState();
+        TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, next_state};
+        this->setDefault(current_state, move_left);
+        current_state = next_state;
+    }
+
+    size_t unmark_state = this->addState();
+    this->genLoad(current_state, bytes, unmark_state, base_offset, TAPE_TEMP2);
+    this->genUnmarkIndex(unmark_state, 6 - bytes, end_state, true);
+}
+
+void TuringCompiler::genCounterStoreInd(size_t start_state, size_t bytes, size_t end_state, size_t base_offset, size_t base_token) {
+    size_t done_state = this->addState();
+    this->genMarkIndex(start_state, base_token, done_state);
+
+    size_t current_state = done_state;
+    for(size_t i = 0; i < 4; ++i) {
+        size_t next_state = this->addState();
+        TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, next_state};
+        this->setDefault(current_state, move_left);
+        current_state = next_state;
+    }
+
+    size_t unmark_state = this->addState();
+    this->genStore(current_state, bytes, unmark_state, base_offset, TAPE_TEMP2);
+    this->genUnmarkIndex(unmark_state, 6 + bytes, end_state);
+}
+
+void TuringCompiler::genGlobalIndex(size_t start_state, size_t end_state) {
+    // Pops the u32 index on top of the stack, stepping the global tape head right once
+    // per unit while counting the index down to zero
+    size_t dec_states[5];
+    for(size_t i = 0; i < 5; ++i)
+        dec_states[i] = this->addState();
+
+    size_t current_state = start_state;
+    for(size_t i = 0; i < 4; ++i) {
+        size_t next_state = (i == 3) ? dec_states[0] : this->addState();
+        TuringTransition move_left = {TRANS_WILDCARD, (i == 0) ? 0 : TRANS_WILDCARD, TuringDirection::LEFT, next_state};
+        this->setDefault(current_state, move_left);
+        current_state = next_state;
+    }
+
+    // After decrementing byte k the stack head moves k cells back to the low byte
+    size_t back_states[4];
+    back_states[0] = dec_states[0];
+    for(size_t i = 1; i < 4; ++i) {
+        back_states[i] = this->addState();
+        TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, back_states[i - 1]};
+        this->setDefault(back_states[i], move_left);
+    }
+
+    for(size_t i = 0; i < 4; ++i) {
+        size_t step_state = this->addState();
+        this->setTape(step_state, GLOBAL_TAPE);
+        TuringTransition step_global = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, back_states[i]};
+        this->setDefault(step_state, step_global);
+
+        for(size_t j = 1; j < 256; ++j) {
+            TuringTransition decrement = {j, j - 1, TuringDirection::STAY, step_state};
+            this->addTransition(dec_states[i], decrement);
+        }
+        TuringTransition borrow = {0, 255, TuringDirection::RIGHT, dec_states[i + 1]};
+        this->addTransition(dec_states[i], borrow);
+    }
+
+    // A borrow out of the high byte means the index was zero, the bytes left behind are cleared
+    current_state = this->addState();
+    TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, current_state};
+    this->setDefault(dec_states[4], move_left);
+
+    for(size_t i = 0; i < 4; ++i) {
+        size_t next_state = (i == 3) ? end_state : this->addState();
+        TuringTransition clear_trans = {TRANS_WILDCARD, 0, (i == 3) ? TuringDirection::STAY : TuringDirection::LEFT, next_state};
+        this->setDefault(current_state, clear_trans);
+        current_state = next_state;
+    }
+}
+
+void TuringCompiler::genGlobalLoad(size_t start_state, size_t bytes, size_t end_state, size_t offset) {
+    // The global tape head rests on GP, or on the element an index moved it to,
+    // and returns to GP once the bytes are copied
+    size_t home_state = this->addState();
+    this->setTape(home_state, GLOBAL_TAPE);
+    TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, home_state};
+    TuringTransition move_to_base_found = {TAPE_GP, TAPE_GP, TuringDirection::STAY, end_state};
+    this->setDefault(home_state, move_to_base_loop);
+    this->addTransition(home_state, move_to_base_found);
+
+    size_t current_state = this->addState();
+    this->setTape(current_state, GLOBAL_TAPE);
+    TuringTransition switch_tape = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, current_state};
+    this->setDefault(start_state, switch_tape);
+
+    for(size_t i = 0; i < (offset + 1); ++i) {
+        size_t next_state = this->addState();
+        this->setTape(next_state, GLOBAL_TAPE);
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+
+    for(size_t j = 0; j < bytes; ++j) {
+        size_t next_state = (j == (bytes - 1)) ? home_state : this->addState();
+        if(next_state != home_state)
+            this->setTape(next_state, GLOBAL_TAPE);
+
+        for(size_t i = 0; i < 256; ++i) {
+            size_t push_state = this->addState();
+            TuringTransition split_trans = {i, i, TuringDirection::RIGHT, push_state};
+            this->addTransition(current_state, split_trans);
+
+            TuringTransition push_trans = {TRANS_WILDCARD, i, TuringDirection::RIGHT, next_state};
+            this->setDefault(push_state, push_trans);
+        }
+
+        current_state = next_state;
+    }
+}
+
+void TuringCompiler::genGlobalStore(size_t start_state, size_t bytes, size_t end_state, size_t offset) {
+    // Seeks the global tape head to the last byte first so the value pops off the
+    // stack from the top, then returns it to GP
+    size_t home_state = this->addState();
+    this->setTape(home_state, GLOBAL_TAPE);
+    TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, home_state};
+    TuringTransition move_to_base_found = {TAPE_GP, TAPE_GP, TuringDirection::STAY, end_state};
+    this->setDefault(home_state, move_to_base_loop);
+    this->addTransition(home_state, move_to_base_found);
+
+    size_t pop_state = this->addState();
+    size_t current_state = this->addState();
+    this->setTape(current_state, GLOBAL_TAPE);
+    TuringTransition move_left = {TRANS_WILDCARD, 0, TuringDirection::LEFT, current_state};
+    this->setDefault(start_state, move_left);
+
+    for(size_t i = 0; i < (offset + bytes); ++i) {
+        size_t next_state = (i == (offset + bytes - 1)) ? pop_state : this->addState();
+        if(next_state != pop_state)
+            this->setTape(next_state, GLOBAL_TAPE);
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+
+    for(size_t k = 0; k < bytes; ++k) {
+        size_t next_state = (k == (bytes - 1)) ? home_state : this->addState();
+        TuringDirection pop_dir = (k == (bytes - 1)) ? TuringDirection::STAY : TuringDirection::LEFT;
+
+        for(size_t i = 0; i < 256; ++i) {
+            size_t write_state = this->addState();
+            this->setTape(write_state, GLOBAL_TAPE);
+            TuringTransition split_trans = {i, 0, pop_dir, write_state};
+            this->addTransition(current_state, split_trans);
+
+            TuringTransition write_trans = {TRANS_WILDCARD, i, TuringDirection::LEFT, next_state};
+            this->setDefault(write_state, write_trans);
+        }
+
+        current_state = next_state;
+    }
+}
+
+size_t TuringCompiler::genFindVariable(size_t start_state, size_t offset, size_t base_token) {
+    // Marks the top of the stack with TEMP1 and stops on the first byte of the variable
+    size_t current_state = this->addState();
+    TuringTransition write_temp = {TRANS_WILDCARD, TAPE_TEMP1, TuringDirection::LEFT, current_state};
+    this->setDefault(start_state, write_temp);
+
+    size_t next_state = this->addState();
+    TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, current_state};
+    TuringTransition move_to_base_found = {base_token, base_token, TuringDirection::RIGHT, next_state};
+    this->setDefault(current_state, move_to_base_loop);
+    this->addTransition(current_state, move_to_base_found);
+    current_state = next_state;
+
+    for(size_t i = 0; i < offset; ++i) {
+        next_state = this->addState();
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+    return current_state;
+}
+
+size_t TuringCompiler::genFindGlobal(size_t start_state, size_t offset) {
+    // Like genGlobalLoad, the global tape head starts out on GP
+    size_t current_state = this->addState();
+    this->setTape(current_state, GLOBAL_TAPE);
+    TuringTransition switch_tape = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, current_state};
+    this->setDefault(start_state, switch_tape);
+
+    for(size_t i = 0; i < (offset + 1); ++i) {
+        size_t next_state = this->addState();
+        this->setTape(next_state, GLOBAL_TAPE);
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+    return current_state;
+}
+
+size_t TuringCompiler::genReturnToMark(size_t end_state) {
+    size_t return_state = this->addState();
+    TuringTransition loop_to_temp = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, return_state};
+    TuringTransition found_trans = {TAPE_TEMP1, 0, TuringDirection::STAY, end_state};
+    this->setDefault(return_state, loop_to_temp);
+    this->addTransition(return_state, found_trans);
+    return return_state;
+}
+
+size_t TuringCompiler::genReturnToGlobalBase(size_t end_state) {
+    size_t home_state = this->addState();
+    this->setTape(home_state, GLOBAL_TAPE);
+    TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, home_state};
+    TuringTransition move_to_base_found = {TAPE_GP, TAPE_GP, TuringDirection::STAY, end_state};
+    this->setDefault(home_state, move_to_base_loop);
+    this->addTransition(home_state, move_to_base_found);
+    return home_state;
+}
+
+void TuringCompiler::genModify(size_t start_state, size_t bytes, size_t end_state, size_t tape, Opcode op, uint64_t operand) {
+    // Applies the operand to the variable under the head from its low byte up. Once
+    // no carry is left and the rest of the operand is zero, the remaining bytes stay
+    // as they are and the head goes straight to end_state.
+    bool has_carry = op != Opcode::XOR8;
+    std::vector<size_t> normal_states(bytes + 1, end_state);
+    std::vector<size_t> carry_states(bytes + 1, end_state);
+    normal_states[0] = start_state;
+    for(size_t i = 1; i < bytes; ++i) {
+        if((operand >> (8 * i)) != 0) {
+            normal_states[i] = this->addState();
+            if(tape != 0)
+                this->setTape(normal_states[i], tape);
+        }
+        if(has_carry) {
+            carry_states[i] = this->addState();
+            if(tape != 0)
+                this->setTape(carry_states[i], tape);
+        }
+    }
+
+    for(size_t i = 0; i < bytes; ++i) {
+        size_t constant = (operand >> (8 * i)) & 0xFF;
+        for(size_t carry = 0; carry < ((has_carry && i > 0) ? 2 : 1); ++carry) {
+            size_t current_state = carry ? carry_states[i] : normal_states[i];
+            if(current_state == end_state)
+                continue;
+
+            for(size_t j = 0; j < 256; ++j) {
+                size_t result = j ^ constant;
+                bool carry_out = false;
+                if(op == Opcode::ADD8) {
+                    result = (j + constant + carry) % 256;
+                    carry_out = (j + constant + carry) >= 256;
+                }
+                else if(op == Opcode::SUB8) {
+                    result = (j - constant - carry) % 256;
+                    carry_out = j < (constant + carry);
+                }
+
+                size_t next_state = carry_out ? carry_states[i + 1] : normal_states[i + 1];
+                TuringTransition modify = {j, result, TuringDirection::RIGHT, next_state};
+                this->addTransition(current_state, modify);
+            }
+        }
+    }
+}
+
+void TuringCompiler::genUpdate(size_t start_state, size_t bytes, size_t end_state, size_t offset, size_t base_token, Opcode op, uint64_t operand) {
+    // One walk to the variable and back instead of a load, the operation and a store
+    if(base_token == TAPE_GP && this->options.global_tape) {
+        size_t current_state = this->genFindGlobal(start_state, offset);
+        this->genModify(current_state, bytes, this->genReturnToGlobalBase(end_state), GLOBAL_TAPE, op, operand);
+        return;
+    }
+
+    size_t current_state = this->genFindVariable(start_state, offset, base_token);
+    this->genModify(current_state, bytes, this->genReturnToMark(end_state), 0, op, operand);
+}
+
+void TuringCompiler::genBranchEqual(size_t start_state, size_t offset, size_t base_token, uint8_t value, size_t equal_state, size_t other_state) {
+    size_t current_state;
+    size_t equal_return;
+    size_t other_return;
+    TuringDirection direction;
+    if(base_token == TAPE_GP && this->options.global_tape) {
+        current_state = this->genFindGlobal(start_state, offset);
+        equal_return = this->genReturnToGlobalBase(equal_state);
+        other_return = this->genReturnToGlobalBase(other_state);
+        direction = TuringDirection::STAY;
+    }
+    else {
+        current_state = this->genFindVariable(start_state, offset, base_token);
+        equal_return = this->genReturnToMark(equal_state);
+        other_return = this->genReturnToMark(other_state);
+        direction = TuringDirection::RIGHT;
+    }
+
+    for(size_t i = 0; i < 256; ++i) {
+        TuringTransition compare = {i, i, direction, (i == value) ? equal_return : other_return};
+        this->addTransition(current_state, compare);
+    }
+}
+
 void TuringCompiler::genSetRet(size_t start_state, size_t bytes, size_t end_state) {
     size_t current_state = start_state;
     for(size_t i = 0; i < bytes; ++i) {
         size_t final_state = (i == (bytes - 1)) ? end_state : this->addState();
         size_t next_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, 0, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
 
         current_state = next_state;
         size_t join_state = this->addState();
         for(size_t j = 0; j < 256; ++j) {
             next_state = this->addState();
             TuringTransition split_trans = {j, TAPE_TEMP1, TuringDirection::LEFT, next_state};
-            this->states[current_state].transitions.push_back(split_trans);
+            this->addTransition(current_state, split_trans);
 
             size_t found_state = this->addState();
             TuringTransition loop_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, next_state};
-            this->states[next_state].def_transition = loop_left;
+            this->setDefault(next_state, loop_left);
             TuringTransition found_ap = {TAPE_AP, TAPE_AP, TuringDirection::LEFT, found_state};
-            this->states[next_state].transitions.push_back(found_ap);
+            this->addTransition(next_state, found_ap);
 
             for(size_t k = 0; k < (2 + i); ++k) {
                 size_t inter_state = this->addState();
                 TuringTransition move_left_inter = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, inter_state};
-                this->states[found_state].def_transition = move_left_inter;
+                this->setDefault(found_state, move_left_inter);
                 found_state = inter_state;
             }
 
             TuringTransition write_back = {TRANS_WILDCARD, j, TuringDirection::RIGHT, join_state};
-            this->states[found_state].def_transition = write_back;
+            this->setDefault(found_state, write_back);
         }
 
         TuringTransition move_back = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, join_state};
-        this->states[join_state].def_transition = move_back;
+        this->setDefault(join_state, move_back);
         TuringTransition found_temp = {TAPE_TEMP1, 0, TuringDirection::STAY, final_state};
-        this->states[join_state].transitions.push_back(found_temp);
+        this->addTransition(join_state, found_temp);
 
         current_state = final_state;
     }
 }
 
+void TuringCompiler::genSharedWalks() {
+    // Shared tail of every load and store. A site writes [TEMP1] [ret lo] [ret hi]
+    // at the top of the stack, walks to its own source or destination cell and
+    // jumps in here. The value is carried back to TEMP1, after which the return id
+    // selects the state to continue at.
+    if(this->walk_return_state != INVALID_STATE)
+        return;
+
+    // The walks are shared by all instructions, so they are not counted towards the first
+    uint32_t site_ip = this->current_ip;
+    this->current_ip = NO_IP;
+
+    this->walk_return_state = this->addState();
+    this->held_states.insert(this->walk_return_state);
+    this->walk_return_states.assign(256, INVALID_STATE);
+
+    // Loads: read the source byte and carry it right to TEMP1
+    this->shared_load_split = this->addState();
+    for(size_t i = 0; i < 256; ++i) {
+        size_t carry_state = this->addState();
+        TuringTransition split_trans = {i, i, TuringDirection::RIGHT, carry_state};
+        this->addTransition(this->shared_load_split, split_trans);
+
+        TuringTransition loop_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, carry_state};
+        this->setDefault(carry_state, loop_right);
+        TuringTransition write_back = {TAPE_TEMP1, i, TuringDirection::RIGHT, this->walk_return_state};
+        this->addTransition(carry_state, write_back);
+    }
+
+    // Stores: the destination is marked with TEMP1, find the top marker, pop the
+    // value and carry it left to the destination, then go back to the top marker
+    this->shared_store_find_top = this->addState();
+    size_t store_split = this->addState();
+    size_t store_back = this->addState();
+
+    TuringTransition find_top_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, this->shared_store_find_top};
+    TuringTransition find_top_found = {TAPE_TEMP1, TAPE_TEMP1, TuringDirection::LEFT, store_split};
+    this->setDefault(this->shared_store_find_top, find_top_loop);
+    this->addTransition(this->shared_store_find_top, find_top_found);
+
+    for(size_t i = 0; i < 256; ++i) {
+        size_t carry_state = this->addState();
+        TuringTransition split_trans = {i, 0, TuringDirection::LEFT, carry_state};
+        this->addTransition(store_split, split_trans);
+
+        TuringTransition loop_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, carry_state};
+        this->setDefault(carry_state, loop_left);
+        TuringTransition write_back = {TAPE_TEMP1, i, TuringDirection::RIGHT, store_back};
+        this->addTransition(carry_state, write_back);
+    }
+
+    TuringTransition back_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, store_back};
+    TuringTransition back_found = {TAPE_TEMP1, 0, TuringDirection::RIGHT, this->walk_return_state};
+    this->setDefault(store_back, back_loop);
+    this->addTransition(store_back, back_found);
+
+    this->current_ip = site_ip;
+}
+
+size_t TuringCompiler::addWalkReturn(size_t continue_state) {
+    // Returns are dispatched like RET, the low byte first, with both bytes cleared
+    // and the head left on the low byte
+    size_t return_id = this->num_walk_returns++;
+    size_t lower_byte = return_id & 0xFF;
+    size_t upper_byte = return_id >> 8;
+
+    size_t& upper_state = this->walk_return_states[lower_byte];
+    if(upper_state == INVALID_STATE) {
+        uint32_t site_ip = this->current_ip;
+        this->current_ip = NO_IP;
+        upper_state = this->addState();
+        this->current_ip = site_ip;
+        this->held_states.insert(upper_state);
+        TuringTransition read_lower = {lower_byte, 0, TuringDirection::RIGHT, upper_state};
+        this->addTransition(this->walk_return_state, read_lower);
+    }
+
+    TuringTransition read_upper = {upper_byte, 0, TuringDirection::LEFT, continue_state};
+    this->addTransition(upper_state, read_upper);
+    return return_id;
+}
+
+void TuringCompiler::genWalkToBase(size_t start_state, size_t return_id, size_t base_token, size_t offset, size_t end_state) {
+    size_t write_lower = this->addState();
+    size_t write_upper = this->addState();
+    size_t move_back = this->addState();
+    size_t move_below = this->addState();
+    size_t find_base = this->addState();
+
+    TuringTransition write_temp = {TRANS_WILDCARD, TAPE_TEMP1, TuringDirection::RIGHT, write_lower};
+    this->setDefault(start_state, write_temp);
+    TuringTransition write_id = {TRANS_WILDCARD, return_id & 0xFF, TuringDirection::RIGHT, write_upper};
+    this->setDefault(write_lower, write_id);
+    write_id = {TRANS_WILDCARD, return_id >> 8, TuringDirection::LEFT, move_back};
+    this->setDefault(write_upper, write_id);
+
+    TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, move_below};
+    this->setDefault(move_back, move_left);
+    move_left.next_state = find_base;
+    this->setDefault(move_below, move_left);
+
+    size_t current_state = (offset == 0) ? end_state : this->addState();
+    TuringTransition move_to_base_loop = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, find_base};
+    TuringTransition move_to_base_found = {base_token, base_token, TuringDirection::RIGHT, current_state};
+    this->setDefault(find_base, move_to_base_loop);
+    this->addTransition(find_base, move_to_base_found);
+
+    for(size_t i = 0; i < offset; ++i) {
+        size_t next_state = (i == (offset - 1)) ? end_state : this->addState();
+        TuringTransition move_right = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::RIGHT, next_state};
+        this->setDefault(current_state, move_right);
+        current_state = next_state;
+    }
+}
+
+bool TuringCompiler::genSharedLoad(size_t start_state, size_t bytes, size_t end_state, size_t offset, size_t base_token) {
+    if(this->num_walk_returns + bytes > MAX_WALK_RETURNS)
+        return false;
+
+    this->genSharedWalks();
+
+    size_t current_state = start_state;
+    for(size_t j = 0; j < bytes; ++j) {
+        size_t writeback_state = (j == (bytes - 1)) ? end_state : this->addState();
+        size_t return_id = this->addWalkReturn(writeback_state);
+
+        this->genWalkToBase(current_state, return_id, base_token, offset + j, this->shared_load_split);
+        current_state = writeback_state;
+    }
+    return true;
+}
+
+bool TuringCompiler::genSharedStore(size_t start_state, size_t bytes, size_t end_state, size_t offset, size_t base_token) {
+    if(this->num_walk_returns + bytes > MAX_WALK_RETURNS)
+        return false;
+
+    this->genSharedWalks();
+
+    size_t current_state = start_state;
+    for(size_t k = 0; k < bytes; ++k) {
+        size_t next_iter_state = (k == (bytes - 1)) ? end_state : this->addState();
+
+        // The return lands right of the popped cell, step back onto it
+        size_t return_state = this->addState();
+        size_t return_below = this->addState();
+        TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, return_below};
+        this->setDefault(return_state, move_left);
+        move_left.next_state = next_iter_state;
+        this->setDefault(return_below, move_left);
+
+        size_t return_id = this->addWalkReturn(return_state);
+
+        size_t mark_state = this->addState();
+        TuringTransition mark_dest = {TRANS_WILDCARD, TAPE_TEMP1, TuringDirection::RIGHT, this->shared_store_find_top};
+        this->setDefault(mark_state, mark_dest);
+
+        this->genWalkToBase(current_state, return_id, base_token, offset + (bytes - k - 1), mark_state);
+        current_state = next_iter_state;
+    }
+    return true;
+}
+
 void TuringCompiler::genPush8(size_t ip, const Instr& instr) {
     this->genPush(this->getStateForIP(ip), instr.integer, 1, this->getStateForIP(ip + 1));
 }
@@ -731,7 +1513,7 @@ void TuringCompiler::genEnter(size_t ip, const Instr& instr) {
     size_t state = this->getStateForIP(ip);
     size_t next_state = this->getStateForIP(ip+1);
     TuringTransition trans = {TRANS_WILDCARD, TAPE_BP, TuringDirection::RIGHT, next_state};
-    this->states[state].def_transition = trans;
+    this->setDefault(state, trans);
 }
 
 void TuringCompiler::genAlloc(size_t ip, const Instr& instr) {
@@ -741,7 +1523,7 @@ void TuringCompiler::genAlloc(size_t ip, const Instr& instr) {
     for(size_t i = 0; i < instr.integer; ++i) {
         size_t next_state = i == (instr.integer - 1) ? end_state : this->addState();
         TuringTransition write_zero = {TRANS_WILDCARD, 0, TuringDirection::RIGHT, next_state};
-        this->states[current].def_transition = write_zero;
+        this->setDefault(current, write_zero);
         current = next_state;
     }
 }
@@ -753,10 +1535,10 @@ void TuringCompiler::genFree(size_t ip, const Instr& instr) {
     for(size_t i = 0; i < instr.integer; ++i) {
         size_t next_state = this->addState();
         TuringTransition write_zero = {TRANS_WILDCARD, 0, TuringDirection::LEFT, next_state};
-        this->states[current].def_transition = write_zero;
+        this->setDefault(current, write_zero);
         current = next_state;
     }
-    this->states[current].def_transition = {TRANS_WILDCARD, 0, TuringDirection::STAY, end_state};
+    this->setDefault(current, {TRANS_WILDCARD, 0, TuringDirection::STAY, end_state});
 }
 
 void TuringCompiler::genGetLocal8(size_t ip, const Instr& instr) {
@@ -863,14 +1645,14 @@ void TuringCompiler::genMakeArgs(size_t ip, const Instr& instr) {
 
     if(bytes == 0) {
         TuringTransition write_ap = {TRANS_WILDCARD, TAPE_AP, TuringDirection::RIGHT, final_state};
-        this->states[current_state].def_transition = write_ap;
+        this->setDefault(current_state, write_ap);
         return;
     }
 
     for(size_t i = 0; i < bytes; ++i) {
         size_t next_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
         current_state = next_state;
     }
 
@@ -890,7 +1672,7 @@ void TuringCompiler::genMakeArgs(size_t ip, const Instr& instr) {
     for(size_t i = 0; i < 256; ++i) {
         current_states[i] = this->addState();
         TuringTransition write_ap = {i, TAPE_AP, TuringDirection::RIGHT, current_states[i]};
-        this->states[current_state].transitions.push_back(write_ap);
+        this->addTransition(current_state, write_ap);
     }
 
     for(size_t i = 1; i < bytes; ++i) {
@@ -900,7 +1682,7 @@ void TuringCompiler::genMakeArgs(size_t ip, const Instr& instr) {
             size_t cur = current_states[j];
             for(size_t k = 0; k < 256; ++k) {
                 TuringTransition write_back = {k, j, TuringDirection::RIGHT, next_states[k]};
-                this->states[cur].transitions.push_back(write_back);
+                this->addTransition(cur, write_back);
             }
         }
         move_buffer();
@@ -909,7 +1691,7 @@ void TuringCompiler::genMakeArgs(size_t ip, const Instr& instr) {
     for(size_t i = 0; i < 256; ++i) {
         size_t cur = current_states[i];
         TuringTransition write_back = {TRANS_WILDCARD, i, TuringDirection::RIGHT, final_state};
-        this->states[cur].def_transition = write_back;
+        this->setDefault(cur, write_back);
     }
 }
 
@@ -1021,13 +1803,121 @@ void TuringCompiler::genXor32(size_t ip, const Instr& instr) {
     this->genXor(this->getStateForIP(ip), 4, this->getStateForIP(ip + 1));
 }
 
+void TuringCompiler::genAddLocal8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genAddLocal16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genAddLocal32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genSubLocal8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genSubLocal16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genSubLocal32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genXorLocal8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genXorLocal16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genXorLocal32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_BP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genAddArg8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genAddArg16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genAddArg32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genSubArg8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genSubArg16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genSubArg32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genXorArg8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genXorArg16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genXorArg32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_AP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genAddGlobal8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genAddGlobal16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genAddGlobal32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::ADD8, instr.integer2);
+}
+
+void TuringCompiler::genSubGlobal8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genSubGlobal16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genSubGlobal32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::SUB8, instr.integer2);
+}
+
+void TuringCompiler::genXorGlobal8(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 1, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genXorGlobal16(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 2, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::XOR8, instr.integer2);
+}
+
+void TuringCompiler::genXorGlobal32(size_t ip, const Instr& instr) {
+    this->genUpdate(this->getStateForIP(ip), 4, this->getStateForIP(ip+1), instr.integer, TAPE_GP, Opcode::XOR8, instr.integer2);
+}
+
 void TuringCompiler::genIdxShft(size_t ip, const Instr& instr) {
     size_t current_state = this->getStateForIP(ip);
     size_t final_state = this->getStateForIP(ip+1);
     for(size_t i = 0; i < 4; ++i) {
         size_t next_state = this->addState();
         TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = move_left;
+        this->setDefault(current_state, move_left);
         current_state = next_state;
     }
 
@@ -1036,7 +1926,7 @@ void TuringCompiler::genIdxShft(size_t ip, const Instr& instr) {
         current_states[i] = this->addState();
         size_t output = (i << instr.integer) & 0xFF;
         TuringTransition shift_bottom = {i, output, TuringDirection::RIGHT, current_states[i]};
-        this->states[current_state].transitions.push_back(shift_bottom);
+        this->addTransition(current_state, shift_bottom);
     }
 
     size_t next_states[256];
@@ -1061,7 +1951,7 @@ void TuringCompiler::genIdxShft(size_t ip, const Instr& instr) {
                 result |= (k << instr.integer) & 0xFF;
 
                 TuringTransition write_back = {k, result, TuringDirection::RIGHT, next_state};
-                this->states[current_states[j]].transitions.push_back(write_back);
+                this->addTransition(current_states[j], write_back);
             }
         }
         move_states();
@@ -1072,7 +1962,7 @@ void TuringCompiler::genJmp(size_t ip, const Instr& instr) {
     size_t current_state = this->getStateForIP(ip);
     size_t next_state = this->getStateForIP(instr.integer);
     TuringTransition trans = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, next_state};
-    this->states[current_state].def_transition = trans;
+    this->setDefault(current_state, trans);
 }
 
 void TuringCompiler::genJf(size_t ip, const Instr& instr) {
@@ -1080,7 +1970,7 @@ void TuringCompiler::genJf(size_t ip, const Instr& instr) {
     size_t inter_state = this->addState();
 
     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, inter_state};
-    this->states[current_state].def_transition = move_left;
+    this->setDefault(current_state, move_left);
 
     size_t next_state = this->getStateForIP(ip+1);
     size_t jump_state = this->getStateForIP(instr.integer);
@@ -1088,8 +1978,8 @@ void TuringCompiler::genJf(size_t ip, const Instr& instr) {
     TuringTransition take_jump = {0, 0, TuringDirection::STAY, jump_state};
     TuringTransition no_jump = {TRANS_WILDCARD, 0, TuringDirection::STAY, next_state};
 
-    this->states[inter_state].transitions.push_back(take_jump);
-    this->states[inter_state].def_transition = no_jump;
+    this->addTransition(inter_state, take_jump);
+    this->setDefault(inter_state, no_jump);
 }
 
 void TuringCompiler::genJt(size_t ip, const Instr& instr) {
@@ -1097,7 +1987,7 @@ void TuringCompiler::genJt(size_t ip, const Instr& instr) {
     size_t inter_state = this->addState();
 
     TuringTransition move_left = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, inter_state};
-    this->states[current_state].def_transition = move_left;
+    this->setDefault(current_state, move_left);
 
     size_t next_state = this->getStateForIP(ip+1);
     size_t jump_state = this->getStateForIP(instr.integer);
@@ -1105,8 +1995,29 @@ void TuringCompiler::genJt(size_t ip, const Instr& instr) {
     TuringTransition take_jump = {TRANS_WILDCARD, 0, TuringDirection::STAY, jump_state};
     TuringTransition no_jump = {0, 0, TuringDirection::STAY, next_state};
 
-    this->states[inter_state].transitions.push_back(no_jump);
-    this->states[inter_state].def_transition = take_jump;
+    this->addTransition(inter_state, no_jump);
+    this->setDefault(inter_state, take_jump);
+}
+
+void TuringCompiler::genJeqLocal8(size_t ip, const Instr& instr) {
+    size_t current_state = this->getStateForIP(ip);
+    size_t next_state = this->getStateForIP(ip+1);
+    size_t jump_state = this->getStateForIP(instr.integer);
+    this->genBranchEqual(current_state, instr.integer2, TAPE_BP, instr.integer3, jump_state, next_state);
+}
+
+void TuringCompiler::genJeqArg8(size_t ip, const Instr& instr) {
+    size_t current_state = this->getStateForIP(ip);
+    size_t next_state = this->getStateForIP(ip+1);
+    size_t jump_state = this->getStateForIP(instr.integer);
+    this->genBranchEqual(current_state, instr.integer2, TAPE_AP, instr.integer3, jump_state, next_state);
+}
+
+void TuringCompiler::genJeqGlobal8(size_t ip, const Instr& instr) {
+    size_t current_state = this->getStateForIP(ip);
+    size_t next_state = this->getStateForIP(ip+1);
+    size_t jump_state = this->getStateForIP(instr.integer);
+    this->genBranchEqual(current_state, instr.integer2, TAPE_GP, instr.integer3, jump_state, next_state);
 }
 
 void TuringCompiler::genCall(size_t ip, const Instr& instr) {
@@ -1118,35 +2029,35 @@ void TuringCompiler::genCall(size_t ip, const Instr& instr) {
 
         size_t next_state = this->addState();
         TuringTransition write_temp = {TRANS_WILDCARD, TAPE_TEMP1, TuringDirection::LEFT, next_state};
-        this->states[current_state].def_transition = write_temp;
+        this->setDefault(current_state, write_temp);
         current_state = next_state;
 
         uint8_t target_byte = (call_ret_id >> (i * 8)) & 0xFF;
         next_state = this->addState();
 
         TuringTransition find_ap = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::LEFT, current_state};
-        this->states[current_state].def_transition = find_ap;
+        this->setDefault(current_state, find_ap);
         find_ap = {TAPE_AP, target_byte, TuringDirection::RIGHT, next_state};
-        this->states[current_state].transitions.push_back(find_ap);
+        this->addTransition(current_state, find_ap);
 
         size_t temp_states[256];
         for(size_t j = 0; j < 256; ++j) {
             temp_states[j] = this->addState();
 
             TuringTransition write_ap = {j, TAPE_AP, TuringDirection::RIGHT, temp_states[j]};
-            this->states[next_state].transitions.push_back(write_ap);
+            this->addTransition(next_state, write_ap);
         }
         TuringTransition end_trans = {TAPE_TEMP1, TAPE_AP, TuringDirection::RIGHT, final_state};
-        this->states[next_state].transitions.push_back(end_trans);
+        this->addTransition(next_state, end_trans);
 
         for(size_t j = 0; j < 256; ++j) {
             for(size_t k = 0; k < 256; ++k) {
                 TuringTransition write_back = {k, j, TuringDirection::RIGHT, temp_states[k]};
-                this->states[temp_states[j]].transitions.push_back(write_back);
+                this->addTransition(temp_states[j], write_back);
             }
 
             end_trans.output = j;
-            this->states[temp_states[j]].transitions.push_back(end_trans);
+            this->addTransition(temp_states[j], end_trans);
         }
 
         current_state = final_state;
@@ -1158,9 +2069,9 @@ void TuringCompiler::genRet(size_t ip, const Instr& instr) {
     size_t next_state = this->addState();
 
     TuringTransition remove_to_ap = {TRANS_WILDCARD, 0, TuringDirection::LEFT, current_state};
-    this->states[current_state].def_transition = remove_to_ap;
+    this->setDefault(current_state, remove_to_ap);
     TuringTransition ap_found = {TAPE_AP, 0, TuringDirection::LEFT, next_state};
-    this->states[current_state].transitions.push_back(ap_found);
+    this->addTransition(current_state, ap_found);
 
     current_state = next_state;
 
@@ -1172,7 +2083,7 @@ void TuringCompiler::genRet(size_t ip, const Instr& instr) {
         for(size_t i = 0; i <= upper_byte; ++i) {
             next_state = this->addState();
             TuringTransition func_ptr_1 = {i, 0, TuringDirection::LEFT, next_state};
-            this->states[current_state].transitions.push_back(func_ptr_1);
+            this->addTransition(current_state, func_ptr_1);
 
             size_t lower_byte_range = i == upper_byte ? lower_byte : 255;
 
@@ -1180,7 +2091,7 @@ void TuringCompiler::genRet(size_t ip, const Instr& instr) {
                 size_t call_ip = this->jump_target_ips[(i << 8) | j];
                 size_t call_state = this->getStateForIP(call_ip);
                 TuringTransition perform_ret = {j, 0, TuringDirection::STAY, call_state};
-                this->states[next_state].transitions.push_back(perform_ret);
+                this->addTransition(next_state, perform_ret);
             }
         }
     }
@@ -1201,19 +2112,334 @@ void TuringCompiler::genSetRet32(size_t ip, const Instr& instr) {
 void TuringCompiler::genAccept(size_t ip, const Instr& instr) {
     size_t current_state = this->getStateForIP(ip);
     TuringTransition trans = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, 0};
-    this->states[current_state].def_transition = trans;
+    this->setDefault(current_state, trans);
 }
 
 void TuringCompiler::genReject(size_t ip, const Instr& instr) {
     size_t current_state = this->getStateForIP(ip);
     TuringTransition trans = {TRANS_WILDCARD, TRANS_WILDCARD, TuringDirection::STAY, 1};
-    this->states[current_state].def_transition = trans;
+    this->setDefault(current_state, trans);
 }
 
 void TuringCompiler::compileInstr(size_t ip) {
     const Instr& instr = this->instr[ip];
 
+    size_t states_before = this->state_base + this->def_transitions.size();
+    size_t transitions_before = this->transitions.size();
+    this->current_ip = ip;
+
     (this->*(TuringCompiler::GENERATOR_CALLBACKS[static_cast<size_t>(instr.opcode)]))(ip, instr);
+
+    OpcodeStats& stats = this->opcode_stats[static_cast<size_t>(instr.opcode)];
+    ++stats.instructions;
+    stats.states += this->state_base + this->def_transitions.size() - states_before;
+    stats.transitions += this->transitions.size() - transitions_before;
+}
+
+void TuringCompiler::lowerInstr(size_t ip, LoweredInstr& lowered) {
+    // Generate into empty buffers, keeping only the accept and reject states
+    this->state_base = 0;
+    this->def_transitions.resize(2);
+    this->state_tapes.resize(2);
+    this->transitions.clear();
+    this->state_map.clear();
+    this->held_states.clear();
+
+    this->compileInstr(ip);
+
+    lowered.def_transitions.assign(this->def_transitions.begin() + 2, this->def_transitions.end());
+    lowered.def_tapes.assign(this->state_tapes.begin() + 2, this->state_tapes.end());
+    lowered.transitions.swap(this->transitions);
+    lowered.ip_states.assign(this->state_map.begin(), this->state_map.end());
+    lowered.source = &lowered.transitions;
+}
+
+bool TuringCompiler::isTemplateInstr(size_t ip) const {
+    // Control transfer refers to absolute IPs and the shared walks to global states,
+    // everything else only depends on the instruction arguments and on IP and IP + 1
+    Opcode opcode = this->instr[ip].opcode;
+    if(!this->options.template_cache || this->options.shared_walks)
+        return false;
+    return opcode < Opcode::JMP || opcode > Opcode::RET;
+}
+
+TuringCompiler::TemplateKey TuringCompiler::getTemplateKey(size_t ip) const {
+    const Instr& instr = this->instr[ip];
+    return TemplateKey(static_cast<size_t>(instr.opcode), instr.integer, instr.integer2);
+}
+
+void TuringCompiler::instantiateTemplate(size_t ip, const LoweredInstr& tmpl, LoweredInstr& lowered) {
+    lowered.def_transitions = tmpl.def_transitions;
+    lowered.def_tapes = tmpl.def_tapes;
+    lowered.ip_states.clear();
+    for(const auto& ip_state : tmpl.ip_states)
+        lowered.ip_states.emplace_back(ip + ip_state.first, ip_state.second);
+    lowered.source = &tmpl.transitions;
+}
+
+void TuringCompiler::addTemplate(size_t ip, LoweredInstr& lowered) {
+    if(this->template_transitions + lowered.transitions.size() > MAX_TEMPLATE_TRANSITIONS)
+        return;
+
+    auto inserted = this->templates.emplace(this->getTemplateKey(ip), LoweredInstr());
+    if(!inserted.second)
+        return;
+
+    LoweredInstr& tmpl = inserted.first->second;
+    tmpl.def_transitions = lowered.def_transitions;
+    tmpl.def_tapes = lowered.def_tapes;
+    for(const auto& ip_state : lowered.ip_states)
+        tmpl.ip_states.emplace_back(ip_state.first - ip, ip_state.second);
+    tmpl.transitions.swap(lowered.transitions);
+    lowered.source = &tmpl.transitions;
+    this->template_transitions += tmpl.transitions.size();
+}
+
+void TuringCompiler::assignStates(size_t ip, LoweredInstr& lowered) {
+    // Create the global states in the same order the worker created its local ones,
+    // so the result is numbered exactly as if the instruction was compiled here
+    size_t num_local = lowered.def_transitions.size() + 2;
+    std::vector<size_t> local_ips(num_local, INVALID_STATE);
+    for(const auto& ip_state : lowered.ip_states)
+        local_ips[ip_state.second] = ip_state.first;
+
+    size_t states_before = this->state_base + this->def_transitions.size();
+    this->current_ip = ip;
+    lowered.mapping.resize(num_local);
+    lowered.mapping[0] = 0;
+    lowered.mapping[1] = 1;
+    for(size_t i = 2; i < num_local; ++i)
+        lowered.mapping[i] = (local_ips[i] != INVALID_STATE) ? this->getStateForIP(local_ips[i]) : this->addState();
+
+    if(this->state_base + this->def_transitions.size() > UINT32_MAX)
+        throw ProgramException("Too many states: ", this->state_base + this->def_transitions.size());
+
+    // Other IP states are only referenced, their defaults are placeholders
+    for(size_t i = 2; i < num_local; ++i) {
+        if(local_ips[i] == INVALID_STATE || local_ips[i] == ip) {
+            TuringTransition def_transition = unpack_transition(lowered.def_transitions[i - 2]);
+            def_transition.next_state = lowered.mapping[def_transition.next_state];
+            this->setDefault(lowered.mapping[i], def_transition);
+        }
+        if(local_ips[i] == INVALID_STATE && lowered.def_tapes[i - 2] != 0)
+            this->setTape(lowered.mapping[i], lowered.def_tapes[i - 2]);
+    }
+
+    OpcodeStats& stats = this->opcode_stats[static_cast<size_t>(this->instr[ip].opcode)];
+    ++stats.instructions;
+    stats.states += this->state_base + this->def_transitions.size() - states_before;
+    stats.transitions += lowered.source->size();
+}
+
+void TuringCompiler::relocateTransitions(const LoweredInstr& lowered, PendingTransition* out) {
+    for(const PendingTransition& pending : *lowered.source) {
+        out->state = lowered.mapping[pending.state];
+        out->trans = pending.trans;
+        out->trans.next_state = lowered.mapping[pending.trans.next_state];
+        ++out;
+    }
+}
+
+void TuringCompiler::compileAll(BinaryWriter* writer) {
+    // Instructions are lowered in batches into locally numbered buffers, by per-thread
+    // compilers or by copying a cached template of an identical earlier instruction.
+    // States are then assigned in instruction order and the transitions relocated into
+    // their final place in parallel. The shared walk states are global to the compiler,
+    // so --shared-walks always compiles directly.
+    std::vector<std::unique_ptr<TuringCompiler>> workers;
+    if(!this->options.shared_walks && (this->options.threads > 1 || this->options.template_cache)) {
+        CompilerOptions worker_options = this->options;
+        worker_options.threads = 1;
+        worker_options.debug_info = false;
+        for(size_t i = 0; i < std::max<size_t>(this->options.threads, 1); ++i)
+            workers.push_back(std::make_unique<TuringCompiler>(this->instr, this->num_instr, worker_options));
+    }
+
+    size_t batch_size = workers.empty() ? 1 : workers.size() * 4;
+    std::vector<LoweredInstr> lowered(workers.empty() ? 0 : batch_size);
+    std::vector<size_t> offsets(batch_size);
+
+    auto parallel_for = [&](size_t begin, size_t end, const auto& func) {
+        if(workers.size() == 1) {
+            for(size_t ip = begin; ip < end; ++ip)
+                func(0, ip);
+            return;
+        }
+
+        std::atomic<size_t> next_ip(begin);
+        std::vector<std::exception_ptr> errors(workers.size());
+        std::vector<std::thread> threads;
+
+        for(size_t t = 0; t < workers.size(); ++t) {
+            threads.emplace_back([&, t]() {
+                try {
+                    for(size_t ip = next_ip++; ip < end; ip = next_ip++)
+                        func(t, ip);
+                }
+                catch(...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for(std::thread& thread : threads)
+            thread.join();
+        for(const std::exception_ptr& error : errors) {
+            if(error)
+                std::rethrow_exception(error);
+        }
+    };
+
+    for(size_t begin = 0; begin < this->num_instr; begin += batch_size) {
+        size_t end = std::min(begin + batch_size, this->num_instr);
+
+        if(workers.empty()) {
+            this->compileInstr(begin);
+        }
+        else {
+            // The template cache is only read while lowering and filled in afterwards
+            parallel_for(begin, end, [&](size_t t, size_t ip) {
+                auto it = this->isTemplateInstr(ip) ? this->templates.find(this->getTemplateKey(ip)) : this->templates.end();
+                if(it != this->templates.end())
+                    this->instantiateTemplate(ip, it->second, lowered[ip - begin]);
+                else
+                    workers[t]->lowerInstr(ip, lowered[ip - begin]);
+            });
+
+            size_t num_transitions = this->transitions.size();
+            for(size_t ip = begin; ip < end; ++ip) {
+                LoweredInstr& current = lowered[ip - begin];
+                if(current.source == &current.transitions && this->isTemplateInstr(ip))
+                    this->addTemplate(ip, current);
+
+                this->assignStates(ip, current);
+                offsets[ip - begin] = num_transitions;
+                num_transitions += current.source->size();
+            }
+
+            this->transitions.resize(num_transitions);
+            parallel_for(begin, end, [&](size_t, size_t ip) {
+                this->relocateTransitions(lowered[ip - begin], &this->transitions[offsets[ip - begin]]);
+                lowered[ip - begin] = LoweredInstr();
+            });
+        }
+
+        // The state of an instruction is complete once that instruction is compiled
+        if(writer) {
+            for(size_t ip = begin; ip < end; ++ip) {
+                size_t ip_state = this->state_map[ip];
+                this->held_states.erase(ip_state);
+                if(ip_state < this->state_base)
+                    this->released_states.push_back(ip_state);
+            }
+            this->flushStates(*writer);
+        }
+    }
+}
+
+void TuringCompiler::buildMachine(TuringMachine& machine) {
+    // Group the pending transitions per state, keeping their order, into one arena
+    size_t num_states = this->def_transitions.size();
+    machine.states.resize(num_states);
+    for(size_t i = 0; i < num_states; ++i) {
+        machine.states[i].num_transitions = 0;
+        machine.states[i].def_transition = this->def_transitions[i];
+        machine.states[i].tape = this->state_tapes[i];
+    }
+
+    for(const PendingTransition& pending : this->transitions)
+        ++machine.states[pending.state].num_transitions;
+
+    uint64_t offset = 0;
+    for(TuringState& state : machine.states) {
+        state.first_transition = offset;
+        offset += state.num_transitions;
+        state.num_transitions = 0;
+    }
+
+    machine.transitions.resize(offset);
+    for(const PendingTransition& pending : this->transitions) {
+        TuringState& state = machine.states[pending.state];
+        machine.transitions[state.first_transition + state.num_transitions++] = pending.trans;
+    }
+
+    this->def_transitions = std::vector<PackedTransition>();
+    this->state_tapes = std::vector<uint8_t>();
+    this->transitions = std::vector<PendingTransition>();
+}
+
+void TuringCompiler::flushStates(BinaryWriter& writer) {
+    // Write out every state that can no longer change. States in held_states may
+    // still be patched by later instructions, they are kept until released.
+    size_t num_window = this->def_transitions.size();
+    size_t num_slots = num_window + this->released_states.size();
+
+    std::unordered_map<size_t, size_t> released_slots;
+    for(size_t i = 0; i < this->released_states.size(); ++i)
+        released_slots[this->released_states[i]] = num_window + i;
+
+    auto slot_of = [&](size_t state) {
+        return (state >= this->state_base) ? state - this->state_base : released_slots.at(state);
+    };
+
+    std::vector<uint64_t> offsets(num_slots + 1, 0);
+    std::vector<PendingTransition> kept;
+    for(const PendingTransition& pending : this->transitions) {
+        if(this->held_states.count(pending.state) != 0)
+            kept.push_back(pending);
+        else
+            ++offsets[slot_of(pending.state) + 1];
+    }
+
+    for(size_t i = 0; i < num_slots; ++i)
+        offsets[i + 1] += offsets[i];
+
+    std::vector<PackedTransition> arena(offsets[num_slots]);
+    std::vector<uint64_t> fill(offsets.begin(), offsets.end() - 1);
+    for(const PendingTransition& pending : this->transitions) {
+        if(this->held_states.count(pending.state) == 0)
+            arena[fill[slot_of(pending.state)]++] = pending.trans;
+    }
+    this->transitions = std::move(kept);
+
+    auto write_slot = [&](size_t state, size_t slot, const PackedTransition& def_transition, size_t tape) {
+        std::span<const PackedTransition> trans(arena.data() + offsets[slot], offsets[slot + 1] - offsets[slot]);
+        writer.acceptState(state, def_transition, trans, tape);
+    };
+
+    for(size_t i = 0; i < num_window; ++i) {
+        size_t state = this->state_base + i;
+        if(this->held_states.count(state) != 0)
+            this->held_defaults[state] = this->def_transitions[i];
+        else
+            write_slot(state, i, this->def_transitions[i], this->state_tapes[i]);
+    }
+
+    for(size_t state : this->released_states) {
+        write_slot(state, released_slots[state], this->held_defaults[state], 0);
+        this->held_defaults.erase(state);
+    }
+
+    this->state_base += num_window;
+    this->def_transitions.clear();
+    this->state_tapes.clear();
+    this->released_states.clear();
+}
+
+size_t TuringCompiler::genStartState() {
+    size_t start_state = this->addState();
+    size_t stack_start = start_state;
+
+    // With a global tape its start is marked by GP, where its head rests between accesses
+    if(this->options.global_tape) {
+        stack_start = this->addState();
+        TuringTransition mark_globals = {TRANS_WILDCARD, TAPE_GP, TuringDirection::STAY, stack_start};
+        this->setDefault(start_state, mark_globals);
+        this->setTape(start_state, GLOBAL_TAPE);
+    }
+
+    TuringTransition push_global_pointer = {TRANS_WILDCARD, TAPE_GP, TuringDirection::RIGHT, this->getStateForIP(0)};
+    this->setDefault(stack_start, push_global_pointer);
+    return start_state;
 }
 
 TuringMachine TuringCompiler::compile() {
@@ -1221,15 +2447,51 @@ TuringMachine TuringCompiler::compile() {
     machine.accept_state = 0;
     machine.reject_state = 1;
 
-    size_t start_state = this->addState();
-    TuringTransition push_global_pointer = {TRANS_WILDCARD, TAPE_GP, TuringDirection::RIGHT, this->getStateForIP(0)};
-    this->states[start_state].def_transition = push_global_pointer;
+    size_t start_state = this->genStartState();
     machine.start_state = start_state;
 
-    for(size_t i = 0; i < this->num_instr; ++i) {
-        this->compileInstr(i);
-    }
+    this->compileAll(nullptr);
+
+    this->buildMachine(machine);
+    machine.state_ips = std::move(this->state_ips);
 
-    machine.states = this->states;
+    if(this->options.prune || this->options.minimize)
+        machine = remove_unreachable(bypass_forwarders(machine));
+    if(this->options.minimize)
+        machine = StateMinimizer(machine).run();
+
+    // Merged states keep the instruction of their lowest numbered state
+    this->state_ips = machine.state_ips;
     return machine;
+}
+
+const std::vector<OpcodeStats>& TuringCompiler::getOpcodeStats() const {
+    return this->opcode_stats;
+}
+
+const std::vector<uint32_t>& TuringCompiler::getStateIPs() const {
+    return this->state_ips;
+}
+
+void TuringCompiler::compile(BinaryWriter& writer) {
+    // Passes over the whole machine need it in memory, everything else is
+    // streamed to the writer one instruction at a time
+    if(this->options.prune || this->options.minimize) {
+        writer.accept(this->compile());
+        return;
+    }
+
+    size_t start_state = this->genStartState();
+    writer.begin(start_state, 0, 1);
+
+    this->compileAll(&writer);
+
+    // Whatever is still held (shared states, targets past the last instruction) is final now
+    for(const auto& held : this->held_defaults)
+        this->released_states.push_back(held.first);
+    std::sort(this->released_states.begin(), this->released_states.end());
+    this->held_states.clear();
+    this->flushStates(writer);
+
+    writer.finish();
 }
\ No newline at end of file
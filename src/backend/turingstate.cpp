@@ -1,7 +1,178 @@
 #include "backend/turingstate.hpp"
+#include "exceptions.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+std::span<const PackedTransition> TuringMachine::getTransitions(size_t state) const {
+    const TuringState& info = this->states[state];
+    return std::span<const PackedTransition>(this->transitions.data() + info.first_transition, info.num_transitions);
+}
+
+size_t TuringMachine::getNumTapes() const {
+    size_t num_tapes = 1;
+    for(const TuringState& state : this->states)
+        num_tapes = std::max<size_t>(num_tapes, state.tape + 1);
+    return num_tapes;
+}
+
+PackedTransition pack_transition(const TuringTransition& trans) {
+    auto pack_symbol = [](size_t symbol) -> uint16_t {
+        if(symbol == TRANS_WILDCARD)
+            return PACKED_WILDCARD;
+        if(symbol >= PACKED_WILDCARD)
+            throw ProgramException("Tape symbol ", symbol, " out of range");
+        return symbol;
+    };
+
+    if(trans.next_state > std::numeric_limits<uint32_t>::max())
+        throw ProgramException("State id ", trans.next_state, " out of range");
+
+    PackedTransition result;
+    result.next_state = trans.next_state;
+    result.input = pack_symbol(trans.input);
+    result.output = pack_symbol(trans.output);
+    result.dir = static_cast<uint16_t>(trans.dir);
+    return result;
+}
+
+TuringTransition unpack_transition(const PackedTransition& trans) {
+    auto unpack_symbol = [](uint16_t symbol) -> size_t {
+        return symbol == PACKED_WILDCARD ? TRANS_WILDCARD : symbol;
+    };
+
+    TuringTransition result;
+    result.input = unpack_symbol(trans.input);
+    result.output = unpack_symbol(trans.output);
+    result.dir = static_cast<TuringDirection>(trans.dir);
+    result.next_state = trans.next_state;
+    return result;
+}
+
+TuringMachine renumber_machine(const TuringMachine& machine, const std::vector<size_t>& mapping, size_t num_states) {
+    // States mapped to the same new id are merged, the lowest old id among them provides the transitions
+    std::vector<size_t> representatives(num_states, INVALID_STATE);
+    for(size_t i = mapping.size(); i > 0; --i) {
+        if(mapping[i-1] != INVALID_STATE)
+            representatives[mapping[i-1]] = i-1;
+    }
+
+    auto map_state = [&](size_t state) {
+        if(mapping[state] == INVALID_STATE)
+            throw ProgramException("Renumbering removes live state ", state);
+        return mapping[state];
+    };
+
+    TuringMachine result;
+    result.start_state = map_state(machine.start_state);
+    result.accept_state = map_state(machine.accept_state);
+    result.reject_state = map_state(machine.reject_state);
+    result.states.resize(num_states);
+
+    for(size_t i = 0; i < num_states; ++i) {
+        size_t old_state = representatives[i];
+        if(old_state == INVALID_STATE)
+            throw ProgramException("Renumbering leaves state ", i, " undefined");
+
+        TuringState& state = result.states[i];
+        state.def_transition = machine.states[old_state].def_transition;
+        state.def_transition.next_state = map_state(state.def_transition.next_state);
+        state.tape = machine.states[old_state].tape;
+        state.first_transition = result.transitions.size();
+        state.num_transitions = machine.states[old_state].num_transitions;
+
+        for(PackedTransition trans : machine.getTransitions(old_state)) {
+            trans.next_state = map_state(trans.next_state);
+            result.transitions.push_back(trans);
+        }
+    }
+
+    if(!machine.state_ips.empty()) {
+        result.state_ips.resize(num_states);
+        for(size_t i = 0; i < num_states; ++i)
+            result.state_ips[i] = machine.state_ips[representatives[i]];
+    }
+
+    return result;
+}
+
+TuringMachine remove_unreachable(const TuringMachine& machine) {
+    // Accept and reject are kept even if no path leads there, numbering follows the old order
+    std::vector<bool> reachable(machine.states.size(), false);
+    std::vector<size_t> worklist = {machine.start_state, machine.accept_state, machine.reject_state};
+    for(size_t state : worklist)
+        reachable[state] = true;
+
+    while(!worklist.empty()) {
+        size_t state = worklist.back();
+        worklist.pop_back();
+
+        auto visit = [&](size_t next_state) {
+            if(!reachable[next_state]) {
+                reachable[next_state] = true;
+                worklist.push_back(next_state);
+            }
+        };
+        visit(machine.states[state].def_transition.next_state);
+        for(const PackedTransition& trans : machine.getTransitions(state))
+            visit(trans.next_state);
+    }
+
+    std::vector<size_t> mapping(machine.states.size(), INVALID_STATE);
+    size_t num_states = 0;
+    for(size_t i = 0; i < machine.states.size(); ++i) {
+        if(reachable[i])
+            mapping[i] = num_states++;
+    }
+
+    return renumber_machine(machine, mapping, num_states);
+}
+
+TuringMachine bypass_forwarders(const TuringMachine& machine) {
+    // A forwarder has no transitions and its default neither writes nor moves, so
+    // anything entering it can go to the end of the forwarding chain directly
+    auto is_forwarder = [&](size_t state) {
+        const TuringState& info = machine.states[state];
+        return state != machine.accept_state && state != machine.reject_state
+            && info.num_transitions == 0
+            && info.def_transition.input == PACKED_WILDCARD
+            && info.def_transition.output == PACKED_WILDCARD
+            && static_cast<TuringDirection>(info.def_transition.dir) == TuringDirection::STAY;
+    };
+
+    size_t num_states = machine.states.size();
+    std::vector<size_t> targets(num_states, INVALID_STATE);
+    std::vector<bool> on_path(num_states, false);
+    std::vector<size_t> path;
+
+    for(size_t i = 0; i < num_states; ++i) {
+        size_t state = i;
+        while(targets[state] == INVALID_STATE && !on_path[state] && is_forwarder(state)) {
+            on_path[state] = true;
+            path.push_back(state);
+            state = machine.states[state].def_transition.next_state;
+        }
+
+        // A cycle of forwarders never ends, it is kept as a loop on one of its states
+        size_t target = targets[state] != INVALID_STATE ? targets[state] : state;
+        targets[state] = target;
+        for(size_t forwarder : path) {
+            targets[forwarder] = target;
+            on_path[forwarder] = false;
+        }
+        path.clear();
+    }
+
+    TuringMachine result = machine;
+    result.start_state = targets[machine.start_state];
+    for(TuringState& info : result.states)
+        info.def_transition.next_state = targets[info.def_transition.next_state];
+    for(PackedTransition& trans : result.transitions)
+        trans.next_state = targets[trans.next_state];
+
+    return result;
+}
+
 std::ostream& operator<<(std::ostream& os, const TuringDirection& dir) {
     switch(dir) {
         case TuringDirection::STAY:
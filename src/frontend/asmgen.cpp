@@ -5,6 +5,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <bit>
+#include <utility>
 
 inline Opcode overload_size(DataType type, Opcode op_base) {
     return static_cast<Opcode>(static_cast<size_t>(op_base) + static_cast<size_t>(type) - static_cast<size_t>(DataType::U8));
@@ -27,7 +28,40 @@ inline Opcode get_overloaded_op(NodeType type, DataType data_type) {
     }
 }
 
-AsmGenerator::AsmGenerator(ASTNode* root, Symtab* symtab) : root(root), symtab(symtab) {}
+inline Opcode get_fused_op(NodeType type, DataType data_type, bool is_arg, bool is_global) {
+    // The LOCAL, ARG and GLOBAL families of the fused opcodes follow each other
+    size_t family = is_arg ? 1 : is_global ? 2 : 0;
+    size_t stride = static_cast<size_t>(Opcode::ADDARG8) - static_cast<size_t>(Opcode::ADDLOCAL8);
+    Opcode local_op;
+    switch(type) {
+        case NodeType::ADD_EXPR:
+            local_op = Opcode::ADDLOCAL8;
+            break;
+        case NodeType::SUB_EXPR:
+            local_op = Opcode::SUBLOCAL8;
+            break;
+        case NodeType::XOR_EXPR:
+            local_op = Opcode::XORLOCAL8;
+            break;
+        default:
+            return Opcode::REJECT;
+    }
+    return overload_size(data_type, static_cast<Opcode>(static_cast<size_t>(local_op) + family * stride));
+}
+
+inline bool is_constant(ASTNode* node) {
+    switch(node->type) {
+        case NodeType::INT_CONST:
+        case NodeType::U8_INT_CONST:
+        case NodeType::U16_INT_CONST:
+        case NodeType::U32_INT_CONST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+AsmGenerator::AsmGenerator(ASTNode* root, Symtab* symtab, bool superinstructions) : root(root), symtab(symtab), superinstructions(superinstructions) {}
 
 std::string AsmGenerator::nextLabelName() {
     std::stringstream result;
@@ -49,7 +83,7 @@ void AsmGenerator::generateGlobals(ASTNode* node) {
 void AsmGenerator::generateGlobal(ASTNode* node) {
     size_t global_size = this->symtab->getGlobalSpaceSize();
     if(global_size > 0)
-        this->instrs.push_back(make_instr(Opcode::ALLOC, this->symtab->getGlobalSpaceSize()));
+        this->emit(make_instr(Opcode::ALLOC, this->symtab->getGlobalSpaceSize()));
 
     this->generateGlobals(node);
 }
@@ -65,7 +99,92 @@ void AsmGenerator::generateFunctions(ASTNode* node) {
     }
 }
 
+bool AsmGenerator::getVariable(ASTNode* node, size_t& symbol, size_t& offset) {
+    // Variables at a fixed offset, which the fused instructions work on directly
+    if(node->type != NodeType::ID_EXPR && node->type != NodeType::SUBSCRIPT_CONST)
+        return false;
+
+    symbol = node->integer;
+    offset = this->symtab->getStackOffset(symbol);
+    if(node->type == NodeType::SUBSCRIPT_CONST)
+        offset += node->integer2 * datatype_size(node->datatype);
+    return true;
+}
+
+bool AsmGenerator::generateUpdate(ASTNode* node) {
+    // x = x op c as a statement changes x in place, the value itself is not needed
+    if(node->type != NodeType::ASSIGN_EXPR && node->type != NodeType::ARRAY_ASSIGN_CONST)
+        return false;
+
+    ASTNode* value = node->children[0];
+    if(value->datatype != node->datatype || get_fused_op(value->type, node->datatype, false, false) == Opcode::REJECT)
+        return false;
+
+    ASTNode* lhs = value->children[0];
+    ASTNode* rhs = value->children[1];
+    if(value->type != NodeType::SUB_EXPR && is_constant(lhs))
+        std::swap(lhs, rhs);
+
+    size_t symbol, offset;
+    if(!is_constant(rhs) || !this->getVariable(lhs, symbol, offset) || symbol != node->integer)
+        return false;
+
+    size_t dest_offset = this->symtab->getStackOffset(symbol);
+    if(node->type == NodeType::ARRAY_ASSIGN_CONST)
+        dest_offset += node->integer2 * datatype_size(node->datatype);
+    if(offset != dest_offset)
+        return false;
+
+    uint64_t mask = (uint64_t(1) << (8 * datatype_size(node->datatype))) - 1;
+    Opcode op = get_fused_op(value->type, node->datatype, this->symtab->isArgument(symbol), this->symtab->isGlobal(symbol));
+    this->emit(make_instr(op, offset, rhs->integer & mask));
+    return true;
+}
+
+Instr AsmGenerator::generateJumpIfFalse(ASTNode* cond, const std::string& label) {
+    // A condition that only compares the low byte of a variable with a constant
+    // jumps on the variable itself, anything else is computed on the stack first
+    ASTNode* value = cond;
+    if(value->type == NodeType::CAST_EXPR)
+        value = value->children[0];
+
+    uint64_t constant = 0;
+    if(value->type == NodeType::XOR_EXPR) {
+        ASTNode* lhs = value->children[0];
+        ASTNode* rhs = value->children[1];
+        if(is_constant(lhs))
+            std::swap(lhs, rhs);
+        if(is_constant(rhs)) {
+            constant = rhs->integer & 0xFF;
+            value = lhs;
+        }
+    }
+
+    size_t symbol, offset;
+    if(this->superinstructions && cond->datatype == DataType::U8 && this->getVariable(value, symbol, offset)) {
+        Opcode jmp_op = this->symtab->isArgument(symbol) ? Opcode::JEQARG8 : this->symtab->isGlobal(symbol) ? Opcode::JEQGLOBAL8 : Opcode::JEQLOCAL8;
+        Instr jmp = make_instr(jmp_op, offset, constant, label);
+        this->emit(jmp);
+        return jmp;
+    }
+
+    this->generate(cond);
+    Instr jmp = make_instr(Opcode::JF, label);
+    this->emit(jmp);
+    return jmp;
+}
+
+void AsmGenerator::emit(const Instr& instr) {
+    this->instrs.push_back(instr);
+    this->instrs.back().line = this->line;
+}
+
 void AsmGenerator::generate(ASTNode* node) {
+    // Instructions get the line of the innermost statement they are generated for
+    size_t outer_line = this->line;
+    if(node->line != 0)
+        this->line = node->line;
+
     switch(node->type) {
         case NodeType::EMPTY:
             break;
@@ -75,12 +194,12 @@ void AsmGenerator::generate(ASTNode* node) {
             break;
         case NodeType::FUNC_DECL: {
             Instr enter_scope = make_instr(Opcode::ENTER);
-            this->instrs.push_back(enter_scope);
+            this->emit(enter_scope);
 
             size_t local_stack_size = this->symtab->getFunctionLocalSize(node->str);
             if(local_stack_size > 0) {
                 Instr alloc = make_instr(Opcode::ALLOC, local_stack_size);
-                this->instrs.push_back(alloc);
+                this->emit(alloc);
             }
 
             this->generate(node->children[0]);
@@ -89,38 +208,57 @@ void AsmGenerator::generate(ASTNode* node) {
             this->labels[func_ret_label] = this->instrs.size();
 
             Instr ret = make_instr(Opcode::RET);
-            this->instrs.push_back(ret);
+            this->emit(ret);
             break;
         }
         case NodeType::GLOBAL_DECL:
             this->generate(node->children[0]);
             break;
         case NodeType::EXPR_STAT: {
+            if(this->superinstructions && this->generateUpdate(node->children[0]))
+                break;
+
             this->generate(node->children[0]);
             DataType child_type = node->children[0]->datatype;
             if(child_type != DataType::VOID) {
                 Instr dealloc = make_instr(overload_size(child_type, Opcode::POP8));
-                this->instrs.push_back(dealloc);
+                this->emit(dealloc);
+            }
+            break;
+        }
+        case NodeType::DECL_STAT: {
+            // Locals without an initialiser start at zero on every execution of
+            // their declaration, since their slot may be shared with a dead local.
+            // Globals are zeroed once at startup.
+            size_t symb_id = node->integer;
+            if(this->symtab->isGlobal(symb_id))
+                break;
+
+            size_t stack_offset = this->symtab->getStackOffset(symb_id);
+            size_t count = this->symtab->isArray(symb_id) ? this->symtab->getArraySize(symb_id) : 1;
+            size_t remaining = datatype_size(node->datatype) * count;
+            while(remaining > 0) {
+                DataType chunk_type = remaining >= 4 ? DataType::U32 : remaining >= 2 ? DataType::U16 : DataType::U8;
+                this->emit(make_instr(overload_size(chunk_type, Opcode::PUSH8), 0));
+                this->emit(make_instr(overload_size(chunk_type, Opcode::SETLOCAL8), stack_offset));
+                stack_offset += datatype_size(chunk_type);
+                remaining -= datatype_size(chunk_type);
             }
             break;
         }
         case NodeType::IF_STAT: {
-            this->generate(node->children[0]);
-            Instr jmp = make_instr(Opcode::JF, this->nextLabelName());
-            this->instrs.push_back(jmp);
+            Instr jmp = this->generateJumpIfFalse(node->children[0], this->nextLabelName());
 
             this->generate(node->children[1]);
             this->labels[jmp.label] = this->instrs.size();
             break;
         }
         case NodeType::IF_ELSE_STAT: {
-            this->generate(node->children[0]);
-            Instr jmp = make_instr(Opcode::JF, this->nextLabelName());
-            this->instrs.push_back(jmp);
+            Instr jmp = this->generateJumpIfFalse(node->children[0], this->nextLabelName());
 
             this->generate(node->children[1]);
             Instr jmp_2 = make_instr(Opcode::JMP, this->nextLabelName());
-            this->instrs.push_back(jmp_2);
+            this->emit(jmp_2);
             this->labels[jmp.label] = this->instrs.size();
             this->generate(node->children[2]);
             this->labels[jmp_2.label] = this->instrs.size();
@@ -129,14 +267,11 @@ void AsmGenerator::generate(ASTNode* node) {
         case NodeType::WHILE_STAT: {
             std::string cond_label = this->nextLabelName();
             this->labels[cond_label] = this->instrs.size();
-            this->generate(node->children[0]);
-
-            Instr jmp_to_end = make_instr(Opcode::JF, this->nextLabelName());
-            this->instrs.push_back(jmp_to_end);
+            Instr jmp_to_end = this->generateJumpIfFalse(node->children[0], this->nextLabelName());
 
             this->generate(node->children[1]);
             Instr jmp_to_start = make_instr(Opcode::JMP, cond_label);
-            this->instrs.push_back(jmp_to_start);
+            this->emit(jmp_to_start);
             this->labels[jmp_to_end.label] = this->instrs.size();
             break;
         }
@@ -148,20 +283,20 @@ void AsmGenerator::generate(ASTNode* node) {
         case NodeType::XOR_EXPR:
             this->generate(node->children[0]);
             this->generate(node->children[1]);
-            this->instrs.push_back(make_instr(get_overloaded_op(node->type, node->datatype)));
+            this->emit(make_instr(get_overloaded_op(node->type, node->datatype)));
             break;
         case NodeType::ASSIGN_EXPR: {
             Opcode set_op = this->symtab->isArgument(node->integer) ? Opcode::SETARG8 : this->symtab->isGlobal(node->integer) ? Opcode::SETGLOBAL8 : Opcode::SETLOCAL8;
             size_t stack_offset = this->symtab->getStackOffset(node->integer);
             this->generate(node->children[0]);
-            this->instrs.push_back(make_instr(overload_size(node->datatype, Opcode::DUP8)));
-            this->instrs.push_back(make_instr(overload_size(node->datatype, set_op), stack_offset));
+            this->emit(make_instr(overload_size(node->datatype, Opcode::DUP8)));
+            this->emit(make_instr(overload_size(node->datatype, set_op), stack_offset));
             break;
         }
         case NodeType::ID_EXPR: {
             Opcode get_op = this->symtab->isArgument(node->integer) ? Opcode::GETARG8 : this->symtab->isGlobal(node->integer) ? Opcode::GETGLOBAL8 : Opcode::GETLOCAL8;
             size_t stack_offset = this->symtab->getStackOffset(node->integer);
-            this->instrs.push_back(make_instr(overload_size(node->datatype, get_op), stack_offset));
+            this->emit(make_instr(overload_size(node->datatype, get_op), stack_offset));
             break;
         }
         case NodeType::CAST_EXPR: {
@@ -174,11 +309,11 @@ void AsmGenerator::generate(ASTNode* node) {
 
             if(old_size > new_size) {
                 size_t delta = old_size - new_size;
-                this->instrs.push_back(make_instr(Opcode::FREE, delta));
+                this->emit(make_instr(Opcode::FREE, delta));
             }
             else if(old_size < new_size) {
                 size_t delta = new_size - old_size;
-                this->instrs.push_back(make_instr(Opcode::ALLOC, delta));
+                this->emit(make_instr(Opcode::ALLOC, delta));
             }
 
             break;
@@ -189,7 +324,7 @@ void AsmGenerator::generate(ASTNode* node) {
             size_t index = node->integer2;
             size_t stack_offset = this->symtab->getStackOffset(symb_id);
             stack_offset += index * datatype_size(node->datatype);
-            this->instrs.push_back(make_instr(overload_size(node->datatype, get_op), stack_offset));
+            this->emit(make_instr(overload_size(node->datatype, get_op), stack_offset));
             break;
         }
         case NodeType::SUBSCRIPT_INDR: {
@@ -202,9 +337,9 @@ void AsmGenerator::generate(ASTNode* node) {
             size_t data_size = datatype_size(node->datatype);
             if(data_size > 1) {
                 size_t shift_offset = std::countr_zero(data_size);
-                this->instrs.push_back(make_instr(Opcode::IDXSHFT, shift_offset));
+                this->emit(make_instr(Opcode::IDXSHFT, shift_offset));
             }
-            this->instrs.push_back(make_instr(overload_size(node->datatype, get_op), stack_offset, max_idx));
+            this->emit(make_instr(overload_size(node->datatype, get_op), stack_offset, max_idx));
             break;
         }
         case NodeType::ARRAY_ASSIGN_CONST: {
@@ -214,8 +349,8 @@ void AsmGenerator::generate(ASTNode* node) {
             size_t stack_offset = this->symtab->getStackOffset(symb_id);
             stack_offset += index * datatype_size(node->datatype);
             this->generate(node->children[0]);
-            this->instrs.push_back(make_instr(overload_size(node->datatype, Opcode::DUP8)));
-            this->instrs.push_back(make_instr(overload_size(node->datatype, set_op), stack_offset));
+            this->emit(make_instr(overload_size(node->datatype, Opcode::DUP8)));
+            this->emit(make_instr(overload_size(node->datatype, set_op), stack_offset));
             break;
         }
         case NodeType::ARRAY_ASSIGN_INDR: {
@@ -224,15 +359,15 @@ void AsmGenerator::generate(ASTNode* node) {
             size_t max_idx = (this->symtab->getArraySize(symb_id) - 1) * datatype_size(node->datatype) + 1;
             size_t stack_offset = this->symtab->getStackOffset(symb_id);
             this->generate(node->children[1]);
-            this->instrs.push_back(make_instr(overload_size(node->datatype, Opcode::DUP8)));
+            this->emit(make_instr(overload_size(node->datatype, Opcode::DUP8)));
             this->generate(node->children[0]);
 
             size_t data_size = datatype_size(node->datatype);
             if(data_size > 1) {
                 size_t shift_offset = std::countr_zero(data_size);
-                this->instrs.push_back(make_instr(Opcode::IDXSHFT, shift_offset));
+                this->emit(make_instr(Opcode::IDXSHFT, shift_offset));
             }
-            this->instrs.push_back(make_instr(overload_size(node->datatype, set_op), stack_offset, max_idx));
+            this->emit(make_instr(overload_size(node->datatype, set_op), stack_offset, max_idx));
             break;
         }
 
@@ -240,9 +375,11 @@ void AsmGenerator::generate(ASTNode* node) {
         case NodeType::U8_INT_CONST:
         case NodeType::U16_INT_CONST:
         case NodeType::U32_INT_CONST:
-            this->instrs.push_back(make_instr(overload_size(node->datatype, Opcode::PUSH8), node->integer));
+            this->emit(make_instr(overload_size(node->datatype, Opcode::PUSH8), node->integer));
             break;
     }
+
+    this->line = outer_line;
 }
 
 std::vector<Instr> AsmGenerator::run() {
@@ -250,9 +387,9 @@ std::vector<Instr> AsmGenerator::run() {
     Instr make_args = make_instr(Opcode::MAKEARGS, 0);
     Instr call_entry = make_instr(Opcode::CALL, "entry");
     Instr accept = make_instr(Opcode::ACCEPT);
-    this->instrs.push_back(make_args);
-    this->instrs.push_back(call_entry);
-    this->instrs.push_back(accept);
+    this->emit(make_args);
+    this->emit(call_entry);
+    this->emit(accept);
 
     this->generateFunctions(this->root);
 
@@ -0,0 +1,155 @@
+#include "frontend/constfold.hpp"
+
+inline uint64_t datatype_mask(DataType type) {
+    size_t bits = datatype_size(type) * 8;
+    return bits >= 64 ? UINT64_MAX : ((uint64_t)1 << bits) - 1;
+}
+
+ConstantFolder::ConstantFolder(ASTNode* ast) : ast(ast) {}
+
+bool ConstantFolder::isConstant(ASTNode* node) const {
+    switch(node->type) {
+        case NodeType::INT_CONST:
+        case NodeType::U8_INT_CONST:
+        case NodeType::U16_INT_CONST:
+        case NodeType::U32_INT_CONST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void ConstantFolder::makeConstant(ASTNode* node, uint64_t value) {
+    for(ASTNode* c : node->children)
+        delete c;
+    node->children.clear();
+
+    node->type = NodeType::INT_CONST;
+    node->integer = value & datatype_mask(node->datatype);
+}
+
+void ConstantFolder::collectAssigned(ASTNode* node, std::unordered_set<uint64_t>& assigned) {
+    if(node->type == NodeType::ASSIGN_EXPR)
+        assigned.insert(node->integer);
+
+    for(ASTNode* c : node->children)
+        this->collectAssigned(c, assigned);
+}
+
+void ConstantFolder::forgetAssigned(ASTNode* node) {
+    std::unordered_set<uint64_t> assigned;
+    this->collectAssigned(node, assigned);
+
+    for(uint64_t symbol : assigned)
+        this->known_values.erase(symbol);
+}
+
+void ConstantFolder::foldStatement(ASTNode* node) {
+    // Known values only flow through straight-line code, anything assigned in a
+    // branch or loop body is forgotten where control flow joins
+    switch(node->type) {
+        case NodeType::FUNC_DECL:
+            this->known_values.clear();
+            this->foldStatement(node->children[0]);
+            this->known_values.clear();
+            break;
+        case NodeType::GLOBAL_DECL:
+        case NodeType::EXPR_STAT:
+            this->foldExpr(node->children[0]);
+            break;
+        case NodeType::IF_STAT:
+        case NodeType::IF_ELSE_STAT: {
+            this->foldExpr(node->children[0]);
+
+            auto before = this->known_values;
+            for(size_t i = 1; i < node->children.size(); ++i) {
+                this->known_values = before;
+                this->foldStatement(node->children[i]);
+            }
+
+            this->known_values = before;
+            for(size_t i = 1; i < node->children.size(); ++i)
+                this->forgetAssigned(node->children[i]);
+            break;
+        }
+        case NodeType::WHILE_STAT:
+            this->forgetAssigned(node);
+            this->foldExpr(node->children[0]);
+            this->foldStatement(node->children[1]);
+            this->forgetAssigned(node);
+            break;
+        default:
+            for(ASTNode* c : node->children)
+                this->foldStatement(c);
+            break;
+    }
+}
+
+void ConstantFolder::foldExpr(ASTNode* node) {
+    // Children are visited in the order AsmGenerator evaluates them
+    switch(node->type) {
+        case NodeType::ADD_EXPR:
+        case NodeType::SUB_EXPR:
+        case NodeType::AND_EXPR:
+        case NodeType::OR_EXPR:
+        case NodeType::XOR_EXPR: {
+            this->foldExpr(node->children[0]);
+            this->foldExpr(node->children[1]);
+            if(!this->isConstant(node->children[0]) || !this->isConstant(node->children[1]))
+                break;
+
+            uint64_t a = node->children[0]->integer;
+            uint64_t b = node->children[1]->integer;
+            uint64_t result = 0;
+            switch(node->type) {
+                case NodeType::ADD_EXPR:
+                    result = a + b;
+                    break;
+                case NodeType::SUB_EXPR:
+                    result = a - b;
+                    break;
+                case NodeType::AND_EXPR:
+                    result = a & b;
+                    break;
+                case NodeType::OR_EXPR:
+                    result = a | b;
+                    break;
+                default:
+                    result = a ^ b;
+                    break;
+            }
+            this->makeConstant(node, result);
+            break;
+        }
+        case NodeType::CAST_EXPR:
+            // Narrowing drops the upper bytes and widening zero extends
+            this->foldExpr(node->children[0]);
+            if(this->isConstant(node->children[0]))
+                this->makeConstant(node, node->children[0]->integer);
+            break;
+        case NodeType::ASSIGN_EXPR:
+            this->foldExpr(node->children[0]);
+            if(this->isConstant(node->children[0]))
+                this->known_values[node->integer] = node->children[0]->integer & datatype_mask(node->datatype);
+            else
+                this->known_values.erase(node->integer);
+            break;
+        case NodeType::ID_EXPR:
+            if(this->known_values.count(node->integer) > 0)
+                this->makeConstant(node, this->known_values[node->integer]);
+            break;
+        case NodeType::ARRAY_ASSIGN_INDR:
+            this->foldExpr(node->children[1]);
+            this->foldExpr(node->children[0]);
+            break;
+        default:
+            for(ASTNode* c : node->children)
+                this->foldExpr(c);
+            break;
+    }
+}
+
+void ConstantFolder::run() {
+    this->known_values.clear();
+    this->foldStatement(this->ast);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "frontend/deadfunc.hpp"
+
+#include <vector>
+
+const char* const ENTRY_FUNCTION = "entry";
+
+DeadFunctionEliminator::DeadFunctionEliminator(ASTNode* ast) : ast(ast) {}
+
+void DeadFunctionEliminator::collectFunctions(ASTNode* node) {
+    if(node->type == NodeType::FUNC_DECL) {
+        this->functions[node->str] = node;
+    }
+    else {
+        for(ASTNode* c : node->children)
+            this->collectFunctions(c);
+    }
+}
+
+void DeadFunctionEliminator::collectCalls(ASTNode* node, std::unordered_set<std::string>& callees) {
+    // The language has no call expressions yet, the only call site is the call to
+    // entry emitted by AsmGenerator. New call nodes add their target here.
+    for(ASTNode* c : node->children)
+        this->collectCalls(c, callees);
+}
+
+void DeadFunctionEliminator::removeDead(ASTNode* node) {
+    for(ASTNode*& c : node->children) {
+        if(c->type == NodeType::FUNC_DECL) {
+            if(this->reachable.count(c->str) == 0) {
+                delete c;
+                c = new ASTNode(NodeType::EMPTY, {});
+            }
+        }
+        else {
+            this->removeDead(c);
+        }
+    }
+}
+
+size_t DeadFunctionEliminator::run() {
+    this->functions.clear();
+    this->reachable.clear();
+    this->collectFunctions(this->ast);
+
+    // Without an entry function the linker reports the error, keep everything
+    if(this->functions.count(ENTRY_FUNCTION) == 0)
+        return 0;
+
+    std::vector<std::string> worklist = {ENTRY_FUNCTION};
+    this->reachable.insert(ENTRY_FUNCTION);
+    while(!worklist.empty()) {
+        std::string name = worklist.back();
+        worklist.pop_back();
+
+        std::unordered_set<std::string> callees;
+        this->collectCalls(this->functions[name], callees);
+        for(const std::string& callee : callees) {
+            if(this->functions.count(callee) > 0 && this->reachable.insert(callee).second)
+                worklist.push_back(callee);
+        }
+    }
+
+    size_t removed = this->functions.size() - this->reachable.size();
+    if(removed > 0)
+        this->removeDead(this->ast);
+    return removed;
+}
\ No newline at end of file
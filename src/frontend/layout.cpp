@@ -0,0 +1,79 @@
+#include "frontend/layout.hpp"
+#include "frontend/symtab.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+FrameLayout::FrameLayout(ASTNode* root, Symtab* symtab, const std::unordered_map<size_t, uint64_t>* line_steps) : root(root), symtab(symtab), line_steps(line_steps) {}
+
+uint64_t FrameLayout::accessWeight() const {
+    if(this->line_steps) {
+        auto it = this->line_steps->find(this->line);
+        return it == this->line_steps->end() ? 0 : it->second;
+    }
+
+    uint64_t weight = 1;
+    for(size_t i = 0; i < std::min(this->loop_depth, MAX_LOOP_DEPTH); ++i)
+        weight *= LOOP_WEIGHT;
+    return weight;
+}
+
+void FrameLayout::countAccesses(ASTNode* node) {
+    size_t outer_line = this->line;
+    if(node->line != 0)
+        this->line = node->line;
+
+    switch(node->type) {
+        case NodeType::ID_EXPR:
+        case NodeType::ASSIGN_EXPR:
+        case NodeType::SUBSCRIPT_CONST:
+        case NodeType::SUBSCRIPT_INDR:
+        case NodeType::ARRAY_ASSIGN_CONST:
+        case NodeType::ARRAY_ASSIGN_INDR:
+            this->weights[node->integer] += this->accessWeight();
+            break;
+        default:
+            break;
+    }
+
+    // The condition of a loop runs as often as its body
+    bool is_loop = node->type == NodeType::WHILE_STAT;
+    if(is_loop)
+        ++this->loop_depth;
+    for(ASTNode* c : node->children)
+        this->countAccesses(c);
+    if(is_loop)
+        --this->loop_depth;
+
+    this->line = outer_line;
+}
+
+void FrameLayout::run() {
+    this->weights.assign(this->symtab->getNumSymbols(), 0);
+    this->countAccesses(this->root);
+    this->symtab->layoutFrames(this->weights);
+}
+
+std::unordered_map<size_t, uint64_t> read_line_profile(const std::string& path) {
+    // One "line steps" pair per line, as written by turingrun --profile-output
+    std::ifstream input(path);
+    if(!input)
+        throw ProgramException("Failed to open line profile ", path);
+
+    std::unordered_map<size_t, uint64_t> result;
+    std::string text;
+    while(std::getline(input, text)) {
+        if(utils_trim(text).empty())
+            continue;
+
+        std::istringstream fields(text);
+        size_t line;
+        uint64_t steps;
+        if(!(fields >> line >> steps))
+            throw ParseException("Malformed line in line profile ", path, ": ", text);
+        result[line] += steps;
+    }
+    return result;
+}
\ No newline at end of file
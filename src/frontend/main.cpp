@@ -1,5 +1,9 @@
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
 
 #include "frontend/parser.hpp"
 #include "turingc.parse.h"
@@ -7,35 +11,150 @@
 
 #include "frontend/ast.hpp"
 #include "frontend/semcheck.hpp"
+#include "frontend/constfold.hpp"
+#include "frontend/deadfunc.hpp"
 #include "frontend/asmgen.hpp"
+#include "frontend/layout.hpp"
 #include "frontend/symtab.hpp"
 
 #include "backend/turingcompiler.hpp"
+#include "backend/peephole.hpp"
 #include "output/binarywriter.hpp"
+#include "output/cwriter.hpp"
+#include "output/debuginfo.hpp"
+#include "runner/instrvm.hpp"
 #include "exceptions.hpp"
+#include "utils.hpp"
+#include "stats.hpp"
 
 void yyerror(void* scanner, parse_info* parser, const char* msg) {
-    std::cerr << "Error: " << msg << std::endl;
+    std::cerr << "Error on line " << yyget_lineno(scanner) << ": " << msg << std::endl;
+}
+
+void yyerror(YYLTYPE* location, void* scanner, parse_info* parser, const char* msg) {
+    std::cerr << "Error on line " << location->first_line << ": " << msg << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if(argc < 3) {
+    std::vector<std::string> files;
+    CompilerOptions options;
+    BinaryFormat format = BinaryFormat::V2;
+    bool peephole = true;
+    bool print_stats = false;
+    bool stats_json = false;
+    bool c_output = false;
+    bool native = false;
+    bool fold = true;
+    bool dead_functions = true;
+    bool layout = true;
+    bool superinstructions = true;
+    std::string layout_profile;
+    bool run = false;
+    bool dump_tape = false;
+    uint64_t max_steps = std::numeric_limits<uint64_t>::max();
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--minimize")
+            options.minimize = true;
+        else if(arg == "--shared-walks")
+            options.shared_walks = true;
+        else if(arg.rfind("--threads=", 0) == 0) {
+            uint64_t value;
+            if(!utils_parse_uint(arg.substr(10), value)) {
+                std::cerr << "Invalid value for --threads" << std::endl;
+                return 1;
+            }
+            options.threads = value;
+        }
+        else if(arg == "--no-template-cache")
+            options.template_cache = false;
+        else if(arg.rfind("--counter-index=", 0) == 0) {
+            uint64_t value;
+            if(!utils_parse_uint(arg.substr(16), value)) {
+                std::cerr << "Invalid value for --counter-index" << std::endl;
+                return 1;
+            }
+            options.counter_index = value;
+        }
+        else if(arg == "--global-tape")
+            options.global_tape = true;
+        else if(arg == "--debug-info")
+            options.debug_info = true;
+        else if(arg == "--no-peephole")
+            peephole = false;
+        else if(arg == "--stats")
+            print_stats = true;
+        else if(arg == "--stats=json")
+            print_stats = stats_json = true;
+        else if(arg == "--no-fold")
+            fold = false;
+        else if(arg == "--no-dead-functions")
+            dead_functions = false;
+        else if(arg == "--no-layout")
+            layout = false;
+        else if(arg == "--no-superinstructions")
+            superinstructions = false;
+        else if(arg.rfind("--layout-profile=", 0) == 0)
+            layout_profile = arg.substr(17);
+        else if(arg == "--prune")
+            options.prune = true;
+        else if(arg == "--format=v1")
+            format = BinaryFormat::V1;
+        else if(arg == "--format=v2")
+            format = BinaryFormat::V2;
+        else if(arg == "--format=mapped")
+            format = BinaryFormat::MAPPED;
+        else if(arg == "--format=c")
+            c_output = true;
+        else if(arg == "--format=native")
+            c_output = native = true;
+        else if(arg == "--run")
+            run = true;
+        else if(arg.rfind("--max-steps=", 0) == 0) {
+            uint64_t value;
+            if(!utils_parse_uint(arg.substr(12), value)) {
+                std::cerr << "Invalid value for --max-steps" << std::endl;
+                return 1;
+            }
+            max_steps = value;
+        }
+        else if(arg == "--dump-tape")
+            dump_tape = true;
+        else if(arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+        else
+            files.push_back(arg);
+    }
+
+    // Running only needs the program, the second file is then an optional tape
+    if(files.size() < (run ? 1 : 2)) {
         std::cerr << "Not enough arguments given" << std::endl;
         return 1;
     }
 
-    FILE* file = std::fopen(argv[1], "rb");
+    FILE* file = std::fopen(files[0].c_str(), "rb");
     if(!file) {
-        std::cerr << "Failed to open file " << argv[1] << std::endl;
+        std::cerr << "Failed to open file " << files[0] << std::endl;
         return 1;
     }
 
-    std::ofstream output(argv[2]);
-    if(!output) {
-        std::cerr << "Failed to create file " << argv[2] << std::endl;
-        return 1;
+    std::string output_file;
+    std::ofstream output;
+    if(!run) {
+        output_file = native ? files[1] + ".c" : files[1];
+        output.open(output_file);
+        if(!output) {
+            std::cerr << "Failed to create file " << output_file << std::endl;
+            return 1;
+        }
     }
 
+    CompileStats stats;
+    stats.startPhase("parse");
+
     parse_info parser;
     yyscan_t lexer;
 
@@ -51,22 +170,91 @@ int main(int argc, char* argv[]) {
     if(error)
         return 1;
 
+    stats.endPhase();
+
     ASTNode* root = parser.ast;
     try {
+        stats.startPhase("semcheck");
         SemanticChecker checker(root);
         checker.check();
+        stats.endPhase();
+
+        if(dead_functions) {
+            stats.startPhase("deadfunc");
+            DeadFunctionEliminator(root).run();
+            stats.endPhase();
+        }
+
+        if(fold) {
+            stats.startPhase("fold");
+            ConstantFolder(root).run();
+            stats.endPhase();
+        }
+
+        if(layout) {
+            stats.startPhase("layout");
+            if(layout_profile.empty())
+                FrameLayout(root, parser.symtab).run();
+            else {
+                auto line_steps = read_line_profile(layout_profile);
+                FrameLayout(root, parser.symtab, &line_steps).run();
+            }
+            stats.endPhase();
+        }
 
-        AsmGenerator generator(root, parser.symtab);
+        stats.startPhase("asmgen");
+        AsmGenerator generator(root, parser.symtab, superinstructions);
         auto instrs = generator.run();
+        stats.endPhase();
+
+        if(peephole) {
+            stats.startPhase("peephole");
+            instrs = PeepholeOptimizer(instrs).run();
+            stats.endPhase();
+        }
+        stats.num_instrs = instrs.size();
+
+        if(run) {
+            int result = run_instrs(instrs, files.size() > 1 ? files[1] : "", max_steps, dump_tape);
+            delete root;
+            delete parser.symtab;
+            return result;
+        }
+
         for(const auto& instr : instrs) {
             std::cout << instr << std::endl;
         }
 
-        TuringCompiler compiler(&instrs[0], instrs.size());
-        TuringMachine machine = compiler.compile();
+        TuringCompiler compiler(&instrs[0], instrs.size(), options);
+        BinaryWriter writer(output, format);
 
-        BinaryWriter writer(output);
-        writer.accept(machine);
+        stats.startPhase("compile");
+        if(c_output) {
+            TuringMachine machine = compiler.compile();
+            CWriter(output).accept(machine);
+            stats.num_states = machine.states.size();
+            stats.num_transitions = machine.transitions.size();
+        }
+        else {
+            compiler.compile(writer);
+            stats.num_states = writer.getNumStates();
+            stats.num_transitions = writer.getNumTransitions();
+        }
+        output.close();
+        stats.endPhase();
+
+        // The C translation is only kept around while the system compiler builds it
+        if(native) {
+            stats.startPhase("cc");
+            compile_c_source(output_file, files[1]);
+            std::remove(output_file.c_str());
+            stats.endPhase();
+        }
+
+        stats.opcodes = compiler.getOpcodeStats();
+
+        if(options.debug_info)
+            write_debug_info(debug_info_path(files[1]), make_debug_info(files[0], instrs, compiler.getStateIPs()));
     }
     catch(const ProgramException& err) {
         std::cerr << "Compile error: " << err.what() << std::endl;
@@ -78,5 +266,12 @@ int main(int argc, char* argv[]) {
     delete root;
     delete parser.symtab;
 
+    if(print_stats) {
+        if(stats_json)
+            stats.printJson(std::cerr);
+        else
+            stats.print(std::cerr);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -171,6 +171,7 @@ void SemanticChecker::checkNode(ASTNode* node) {
         case NodeType::LIST:
         case NodeType::FUNC_DECL:
         case NodeType::GLOBAL_DECL:
+        case NodeType::DECL_STAT:
             break;
         case NodeType::EXPR_STAT:
             assert_type_of(node->children[0]->datatype, EXPRESSION_DATA_TYPES);
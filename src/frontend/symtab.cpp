@@ -1,9 +1,14 @@
 #include "frontend/symtab.hpp"
 
+#include <algorithm>
+#include <map>
+#include <utility>
+
 std::string GLOBAL_SCOPE_NAME = "$global";
 
 Symtab::Symtab() {
     this->current_function = GLOBAL_SCOPE_NAME;
+    this->program_point = 0;
 
     this->enterScope();
 }
@@ -12,22 +17,33 @@ void Symtab::enterFunction(const std::string& name) {
     this->current_function = name;
 
     this->function_locals[name] = 0;
+    this->function_frames[name] = 0;
 
     this->enterScope();
 }
 
 void Symtab::exitFunction() {
-    this->current_function = GLOBAL_SCOPE_NAME;
-
     this->exitScope();
+
+    this->current_function = GLOBAL_SCOPE_NAME;
 }
 
 void Symtab::enterScope() {
     this->scopes.push_back({});
+    this->scope_starts.push_back(this->function_locals[this->current_function]);
 }
 
 void Symtab::exitScope() {
+    // The locals of this scope are dead from here on, so the slots they used are
+    // free for whatever is declared next. The frame keeps the largest size seen.
+    for(auto& symbol : this->scopes.back())
+        this->symb_decls[symbol.second].live_end = this->program_point;
+    ++this->program_point;
+
+    this->function_locals[this->current_function] = this->scope_starts.back();
+
     this->scopes.pop_back();
+    this->scope_starts.pop_back();
 }
 
 void Symtab::declareFunction(const std::string& name, DataType type) {
@@ -51,8 +67,13 @@ bool Symtab::declareSymbol(const std::string& name, DataType type, bool is_arg)
     symb_info.is_array = false;
     symb_info.is_global = this->scopes.size() == 1;
     symb_info.array_size = 0;
+    symb_info.function = this->current_function;
+    symb_info.live_start = this->program_point++;
+    symb_info.live_end = std::numeric_limits<size_t>::max();
 
     stack_offset += datatype_size(type);
+    if(!is_arg)
+        this->function_frames[this->current_function] = std::max(this->function_frames[this->current_function], stack_offset);
 
     size_t result = this->symb_decls.size();
     this->symb_decls.push_back(symb_info);
@@ -77,8 +98,13 @@ bool Symtab::declareArray(const std::string& name, DataType type, size_t array_s
     symb_info.is_array = true;
     symb_info.is_global = this->scopes.size() == 1;
     symb_info.array_size = array_size;
+    symb_info.function = this->current_function;
+    symb_info.live_start = this->program_point++;
+    symb_info.live_end = std::numeric_limits<size_t>::max();
 
     stack_offset += datatype_size(type) * array_size;
+    if(!is_arg)
+        this->function_frames[this->current_function] = std::max(this->function_frames[this->current_function], stack_offset);
 
     size_t result = this->symb_decls.size();
     this->symb_decls.push_back(symb_info);
@@ -122,9 +148,73 @@ size_t Symtab::resolveSymbol(const std::string& name) {
 }
 
 size_t Symtab::getFunctionLocalSize(const std::string& name) {
-    return this->function_locals[name];
+    return this->function_frames[name];
 }
 
 size_t Symtab::getGlobalSpaceSize() {
     return this->getFunctionLocalSize(GLOBAL_SCOPE_NAME);
+}
+
+size_t Symtab::getNumSymbols() const {
+    return this->symb_decls.size();
+}
+
+void Symtab::layoutFrames(const std::vector<uint64_t>& weights) {
+    // Every access walks from the base marker past all slots in front of its own, so
+    // placing a frame by weight per cell gives the least walking in total. Arrays
+    // have many cells per access and end up behind the scalars. Arguments are placed
+    // by the caller and keep their order.
+    std::map<std::string, std::vector<size_t>> frames;
+    for(size_t i = 0; i < this->symb_decls.size(); ++i) {
+        if(!this->symb_decls[i].is_arg)
+            frames[this->symb_decls[i].function].push_back(i);
+    }
+
+    auto symbol_size = [&](size_t symb_id) {
+        const SymbolInfo& info = this->symb_decls[symb_id];
+        return datatype_size(info.type) * (info.is_array ? info.array_size : 1);
+    };
+
+    auto overlaps = [&](size_t a, size_t b) {
+        const SymbolInfo& info_a = this->symb_decls[a];
+        const SymbolInfo& info_b = this->symb_decls[b];
+        return info_a.live_start < info_b.live_end && info_b.live_start < info_a.live_end;
+    };
+
+    for(auto& frame : frames) {
+        std::vector<size_t>& symbols = frame.second;
+        std::stable_sort(symbols.begin(), symbols.end(), [&](size_t a, size_t b) {
+            double cells_a = std::max<size_t>(symbol_size(a), 1);
+            double cells_b = std::max<size_t>(symbol_size(b), 1);
+            return weights[a] * cells_b > weights[b] * cells_a;
+        });
+
+        // Each symbol takes the lowest offset not used by an already placed symbol
+        // that is live at the same time
+        std::vector<size_t> placed;
+        size_t frame_size = 0;
+        for(size_t symb_id : symbols) {
+            std::vector<std::pair<size_t, size_t>> taken;
+            for(size_t other : placed) {
+                if(overlaps(symb_id, other)) {
+                    size_t start = this->symb_decls[other].stack_offset;
+                    taken.push_back({start, start + symbol_size(other)});
+                }
+            }
+            std::sort(taken.begin(), taken.end());
+
+            size_t stack_offset = 0;
+            for(auto& range : taken) {
+                if(range.first >= stack_offset + symbol_size(symb_id))
+                    break;
+                stack_offset = std::max(stack_offset, range.second);
+            }
+
+            this->symb_decls[symb_id].stack_offset = stack_offset;
+            frame_size = std::max(frame_size, stack_offset + symbol_size(symb_id));
+            placed.push_back(symb_id);
+        }
+
+        this->function_frames[frame.first] = frame_size;
+    }
 }
\ No newline at end of file
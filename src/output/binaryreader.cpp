@@ -0,0 +1,217 @@
+#include "output/binaryreader.hpp"
+#include "output/binarywriter.hpp"
+#include "exceptions.hpp"
+
+#include <iostream>
+#include <cstdint>
+
+BinaryReader::BinaryReader(std::istream& input) : input(input) {}
+
+template <typename T>
+T BinaryReader::read() {
+    T value;
+    this->input.read((char*)&value, sizeof(T));
+    if(!this->input)
+        throw ParseException("Unexpected end of machine file");
+    return value;
+}
+
+uint64_t BinaryReader::readVarint() {
+    uint64_t value = 0;
+    for(size_t shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = this->read<uint8_t>();
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0)
+            return value;
+    }
+    throw ParseException("Malformed varint in machine file");
+}
+
+int64_t BinaryReader::readSigned() {
+    uint64_t value = this->readVarint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+TuringMachine BinaryReader::parse() {
+    // v1 files start with the start state, v2 files with a magic and version
+    uint64_t header = this->read<uint64_t>();
+    if((header & 0xFFFFFFFF) != MACHINE_MAGIC)
+        return this->parseV1(header);
+
+    uint64_t version = header >> 32;
+    if(version == MAPPED_VERSION)
+        return this->parseMapped();
+    if(version != MACHINE_VERSION)
+        throw ParseException("Unsupported machine file version ", version);
+    return this->parseV2();
+}
+
+TuringMachine BinaryReader::parseV1(uint64_t start_state) {
+    TuringMachine machine;
+    machine.start_state = start_state;
+    machine.accept_state = this->read<uint64_t>();
+    machine.reject_state = this->read<uint64_t>();
+
+    uint64_t num_states = this->read<uint64_t>();
+    machine.states.resize(num_states);
+
+    auto read_transition = [&](TuringTransition& trans) {
+        trans.output = this->read<uint64_t>();
+        trans.dir = (TuringDirection)this->read<uint8_t>();
+        trans.next_state = this->read<uint64_t>();
+
+        if(trans.next_state >= num_states)
+            throw ParseException("Transition to unknown state ", trans.next_state);
+    };
+
+    for(uint64_t i = 0; i < num_states; ++i) {
+        uint64_t index = this->read<uint64_t>();
+        if(index >= num_states)
+            throw ParseException("State index ", index, " out of range");
+
+        TuringState& state = machine.states[index];
+        uint64_t num_trans = this->read<uint64_t>();
+
+        TuringTransition def_transition;
+        def_transition.input = TRANS_WILDCARD;
+        read_transition(def_transition);
+
+        state.def_transition = pack_transition(def_transition);
+        state.first_transition = machine.transitions.size();
+        state.num_transitions = num_trans;
+
+        for(uint64_t j = 0; j < num_trans; ++j) {
+            TuringTransition trans;
+            trans.input = this->read<uint64_t>();
+            read_transition(trans);
+            machine.transitions.push_back(pack_transition(trans));
+        }
+    }
+
+    if(machine.start_state >= num_states || machine.accept_state >= num_states || machine.reject_state >= num_states)
+        throw ParseException("Machine header references unknown state");
+
+    return machine;
+}
+
+TuringMachine BinaryReader::parseV2() {
+    TuringMachine machine;
+
+    uint64_t num_states = this->read<uint64_t>();
+    machine.start_state = this->readVarint();
+    machine.accept_state = this->readVarint();
+    machine.reject_state = this->readVarint();
+
+    if(machine.start_state >= num_states || machine.accept_state >= num_states || machine.reject_state >= num_states)
+        throw ParseException("Machine header references unknown state");
+
+    machine.states.resize(num_states);
+
+    auto read_transition = [&](uint64_t index, PackedTransition& trans) {
+        int64_t next_state = static_cast<int64_t>(index) + this->readSigned();
+        if(next_state < 0 || static_cast<uint64_t>(next_state) >= num_states)
+            throw ParseException("Transition to unknown state ", next_state);
+        trans.next_state = next_state;
+    };
+
+    uint64_t index = -1;
+    for(uint64_t i = 0; i < num_states; ++i) {
+        index += this->readSigned() + 1;
+        if(index >= num_states)
+            throw ParseException("State index ", index, " out of range");
+
+        TuringState& state = machine.states[index];
+
+        PackedTransition def_transition;
+        def_transition.input = PACKED_WILDCARD;
+        def_transition.output = this->read<uint16_t>();
+        uint8_t def_flags = this->read<uint8_t>();
+        def_transition.dir = def_flags & 0x3;
+        state.tape = def_flags >> 2;
+        read_transition(index, def_transition);
+
+        state.def_transition = def_transition;
+        state.first_transition = machine.transitions.size();
+
+        uint64_t num_runs = this->readVarint();
+        for(uint64_t j = 0; j < num_runs; ++j) {
+            uint64_t length = this->readVarint();
+            if(length == 0 || length > PACKED_WILDCARD)
+                throw ParseException("Invalid transition run length ", length);
+
+            PackedTransition trans;
+            trans.input = this->read<uint16_t>();
+            trans.output = this->read<uint16_t>();
+            uint8_t flags = this->read<uint8_t>();
+            trans.dir = flags & 0x3;
+            read_transition(index, trans);
+
+            bool follow_input = (flags & 0x4) != 0;
+            int64_t stride = (length > 1) ? this->readSigned() : 0;
+
+            for(uint64_t k = 0; k < length; ++k) {
+                if(trans.next_state >= num_states)
+                    throw ParseException("Transition to unknown state ", trans.next_state);
+                machine.transitions.push_back(trans);
+
+                ++trans.input;
+                if(follow_input)
+                    ++trans.output;
+                trans.next_state += stride;
+            }
+        }
+
+        state.num_transitions = machine.transitions.size() - state.first_transition;
+    }
+
+    return machine;
+}
+
+TuringMachine BinaryReader::parseMapped() {
+    // Mapped files are normally used in place through MappedMachine, this reads one into memory
+    MappedHeader header;
+    header.start_state = this->read<uint64_t>();
+    header.accept_state = this->read<uint64_t>();
+    header.reject_state = this->read<uint64_t>();
+    header.num_states = this->read<uint64_t>();
+    header.num_transitions = this->read<uint64_t>();
+    header.transitions_offset = this->read<uint64_t>();
+    header.states_offset = this->read<uint64_t>();
+
+    uint64_t transitions_end = header.transitions_offset + header.num_transitions * sizeof(PackedTransition);
+    if(header.transitions_offset < sizeof(MappedHeader) || header.states_offset < transitions_end)
+        throw ParseException("Invalid mapped machine layout");
+
+    TuringMachine machine;
+    machine.start_state = header.start_state;
+    machine.accept_state = header.accept_state;
+    machine.reject_state = header.reject_state;
+
+    if(machine.start_state >= header.num_states || machine.accept_state >= header.num_states || machine.reject_state >= header.num_states)
+        throw ParseException("Machine header references unknown state");
+
+    this->input.ignore(header.transitions_offset - sizeof(MappedHeader));
+    machine.transitions.resize(header.num_transitions);
+    this->input.read((char*)machine.transitions.data(), header.num_transitions * sizeof(PackedTransition));
+
+    this->input.ignore(header.states_offset - transitions_end);
+    machine.states.resize(header.num_states);
+    this->input.read((char*)machine.states.data(), header.num_states * sizeof(TuringState));
+    if(!this->input)
+        throw ParseException("Unexpected end of machine file");
+
+    for(const TuringState& state : machine.states) {
+        if(state.first_transition > header.num_transitions || header.num_transitions - state.first_transition < state.num_transitions)
+            throw ParseException("State transitions out of bounds");
+        if(state.def_transition.next_state >= header.num_states)
+            throw ParseException("Transition to unknown state ", state.def_transition.next_state);
+        if(state.tape >= MAX_TAPES)
+            throw ParseException("State on unknown tape ", state.tape);
+    }
+    for(const PackedTransition& trans : machine.transitions) {
+        if(trans.next_state >= header.num_states)
+            throw ParseException("Transition to unknown state ", trans.next_state);
+    }
+
+    return machine;
+}
\ No newline at end of file
@@ -1,34 +1,238 @@
 #include "output/binarywriter.hpp"
+#include "exceptions.hpp"
 
+#include <algorithm>
 #include <iostream>
 
-BinaryWriter::BinaryWriter(std::ostream& output) : output(output) {}
+BinaryWriter::BinaryWriter(std::ostream& output, BinaryFormat format) : output(output), format(format), num_states(0), num_transitions(0), last_index(0) {}
 
-void BinaryWriter::accept(const TuringMachine& machine) {
-    this->write<uint64_t>(machine.start_state);
-    this->write<uint64_t>(machine.accept_state);
-    this->write<uint64_t>(machine.reject_state);
+void BinaryWriter::writeVarint(uint64_t value) {
+    // LEB128, 7 bits per byte with the high bit set on all but the last byte
+    while(value >= 0x80) {
+        this->write<uint8_t>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    this->write<uint8_t>(value);
+}
+
+void BinaryWriter::writeSigned(int64_t value) {
+    this->writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void BinaryWriter::begin(uint64_t start_state, uint64_t accept_state, uint64_t reject_state) {
+    if(this->format == BinaryFormat::MAPPED) {
+        // The header is rewritten by finish(), transitions are written as they come in
+        // and the state table is appended at the end
+        this->mapped_header = {};
+        this->mapped_header.magic = MACHINE_MAGIC;
+        this->mapped_header.version = MAPPED_VERSION;
+        this->mapped_header.start_state = start_state;
+        this->mapped_header.accept_state = accept_state;
+        this->mapped_header.reject_state = reject_state;
+        this->mapped_header.transitions_offset = sizeof(MappedHeader);
+        this->mapped_states.clear();
+
+        this->count_pos = this->output.tellp();
+        this->num_states = 0;
+        this->num_transitions = 0;
+        this->write<MappedHeader>(this->mapped_header);
+        return;
+    }
+
+    if(this->format == BinaryFormat::V2) {
+        this->write<uint32_t>(MACHINE_MAGIC);
+        this->write<uint32_t>(MACHINE_VERSION);
+    }
+    else {
+        this->write<uint64_t>(start_state);
+        this->write<uint64_t>(accept_state);
+        this->write<uint64_t>(reject_state);
+    }
+
+    // The state count is patched in by finish() once all states have been written
+    this->count_pos = this->output.tellp();
+    this->num_states = 0;
+    this->num_transitions = 0;
+    this->last_index = -1;
+    this->write<uint64_t>(this->num_states);
+
+    if(this->format == BinaryFormat::V2) {
+        this->writeVarint(start_state);
+        this->writeVarint(accept_state);
+        this->writeVarint(reject_state);
+    }
+}
+
+void BinaryWriter::writeStateV1(uint64_t index, const PackedTransition& packed_default, std::span<const PackedTransition> transitions, uint32_t tape) {
+    if(tape != 0)
+        throw ProgramException("v1 machine files only hold single tape machines");
+
+    TuringTransition def_transition = unpack_transition(packed_default);
 
-    uint64_t num_states = machine.states.size();
-    this->write<uint64_t>(num_states);
+    uint64_t num_trans = transitions.size();
 
-    for(uint64_t i = 0; i < num_states; ++i) {
-        const TuringState& state = machine.states[i];
+    this->write<uint64_t>(index);
+    this->write<uint64_t>(num_trans);
+
+    this->write<uint64_t>(def_transition.output);
+    this->write<uint8_t>((uint8_t)def_transition.dir);
+    this->write<uint64_t>(def_transition.next_state);
+
+    for(const PackedTransition& packed : transitions) {
+        TuringTransition trans = unpack_transition(packed);
+        this->write<uint64_t>(trans.input);
+        this->write<uint64_t>(trans.output);
+        this->write<uint8_t>((uint8_t)trans.dir);
+        this->write<uint64_t>(trans.next_state);
+    }
+}
 
-        uint64_t num_trans = state.transitions.size();
+void BinaryWriter::writeStateV2(uint64_t index, const PackedTransition& def_transition, std::span<const PackedTransition> transitions, uint32_t tape) {
+    // Indices and next states are stored as deltas, symbols as the 14-bit packed values.
+    // Transitions are grouped in runs of consecutive inputs with the same direction, an
+    // output that is either constant or follows the input and a constant next state stride,
+    // which covers the 256-way splits the compiler generates.
+    auto state_delta = [&](uint32_t state) {
+        return static_cast<int64_t>(state) - static_cast<int64_t>(index);
+    };
 
-        this->write<uint64_t>(i);
-        this->write<uint64_t>(num_trans);
+    std::vector<size_t> run_lengths;
+    for(size_t i = 0; i < transitions.size();) {
+        size_t length = 1;
+        if(i + 1 < transitions.size()) {
+            const PackedTransition& first = transitions[i];
+            bool follow_input = transitions[i + 1].output != first.output;
+            int64_t stride = static_cast<int64_t>(transitions[i + 1].next_state) - first.next_state;
 
-        this->write<uint64_t>(state.def_transition.output);
-        this->write<uint8_t>((uint8_t)state.def_transition.dir);
-        this->write<uint64_t>(state.def_transition.next_state);
+            while(i + length < transitions.size()) {
+                const PackedTransition& prev = transitions[i + length - 1];
+                const PackedTransition& cur = transitions[i + length];
+                uint16_t expected_output = follow_input ? prev.output + 1 : prev.output;
 
-        for(uint64_t j = 0; j < num_trans; ++j) {
-            this->write<uint64_t>(state.transitions[j].input);
-            this->write<uint64_t>(state.transitions[j].output);
-            this->write<uint8_t>((uint8_t)state.transitions[j].dir);
-            this->write<uint64_t>(state.transitions[j].next_state);
+                if(cur.input != prev.input + 1 || cur.dir != prev.dir || cur.output != expected_output
+                    || static_cast<int64_t>(cur.next_state) - prev.next_state != stride)
+                    break;
+                if(cur.input == PACKED_WILDCARD || (follow_input && cur.output == PACKED_WILDCARD))
+                    break;
+                ++length;
+            }
         }
+
+        run_lengths.push_back(length);
+        i += length;
+    }
+
+    this->writeSigned(static_cast<int64_t>(index - this->last_index - 1));
+    this->last_index = index;
+
+    // The tape of the state shares a byte with the default direction
+    if(tape >= MAX_TAPES)
+        throw ProgramException("Tape ", tape, " out of range");
+    this->write<uint16_t>(def_transition.output);
+    this->write<uint8_t>(def_transition.dir | (tape << 2));
+    this->writeSigned(state_delta(def_transition.next_state));
+
+    this->writeVarint(run_lengths.size());
+
+    size_t offset = 0;
+    for(size_t length : run_lengths) {
+        const PackedTransition& first = transitions[offset];
+        bool follow_input = length > 1 && transitions[offset + 1].output != first.output;
+
+        this->writeVarint(length);
+        this->write<uint16_t>(first.input);
+        this->write<uint16_t>(first.output);
+        this->write<uint8_t>(first.dir | (follow_input ? 0x4 : 0));
+        this->writeSigned(state_delta(first.next_state));
+        if(length > 1)
+            this->writeSigned(static_cast<int64_t>(transitions[offset + 1].next_state) - first.next_state);
+
+        offset += length;
+    }
+}
+
+void BinaryWriter::writeStateMapped(uint64_t index, const PackedTransition& def_transition, std::span<const PackedTransition> transitions, uint32_t tape) {
+    // Sort by input so a simulator can index or binary search, keeping only the
+    // first transition for each input since that is the one that matches
+    std::vector<PackedTransition> sorted(transitions.begin(), transitions.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const PackedTransition& a, const PackedTransition& b) {
+        return a.input < b.input;
+    });
+    auto last = std::unique(sorted.begin(), sorted.end(), [](const PackedTransition& a, const PackedTransition& b) {
+        return a.input == b.input;
+    });
+    sorted.erase(last, sorted.end());
+
+    if(index >= this->mapped_states.size())
+        this->mapped_states.resize(index + 1, TuringState());
+
+    TuringState& state = this->mapped_states[index];
+    state.first_transition = this->mapped_header.num_transitions;
+    state.num_transitions = sorted.size();
+    state.def_transition = def_transition;
+    state.tape = tape;
+
+    this->output.write((const char*)sorted.data(), sorted.size() * sizeof(PackedTransition));
+    this->mapped_header.num_transitions += sorted.size();
+}
+
+void BinaryWriter::finishMapped() {
+    if(this->mapped_states.size() != this->num_states)
+        throw ProgramException("Mapped machine is missing states");
+
+    uint64_t transitions_end = this->mapped_header.transitions_offset + this->mapped_header.num_transitions * sizeof(PackedTransition);
+    uint64_t padding = (alignof(TuringState) - transitions_end % alignof(TuringState)) % alignof(TuringState);
+    for(uint64_t i = 0; i < padding; ++i)
+        this->write<uint8_t>(0);
+
+    this->mapped_header.num_states = this->num_states;
+    this->mapped_header.states_offset = transitions_end + padding;
+    this->output.write((const char*)this->mapped_states.data(), this->mapped_states.size() * sizeof(TuringState));
+    this->mapped_states = std::vector<TuringState>();
+
+    std::streampos end_pos = this->output.tellp();
+    this->output.seekp(this->count_pos);
+    this->write<MappedHeader>(this->mapped_header);
+    this->output.seekp(end_pos);
+}
+
+void BinaryWriter::acceptState(uint64_t index, const PackedTransition& def_transition, std::span<const PackedTransition> transitions, uint32_t tape) {
+    if(this->format == BinaryFormat::MAPPED)
+        this->writeStateMapped(index, def_transition, transitions, tape);
+    else if(this->format == BinaryFormat::V2)
+        this->writeStateV2(index, def_transition, transitions, tape);
+    else
+        this->writeStateV1(index, def_transition, transitions, tape);
+
+    ++this->num_states;
+    this->num_transitions += transitions.size();
+}
+
+void BinaryWriter::finish() {
+    if(this->format == BinaryFormat::MAPPED) {
+        this->finishMapped();
+        return;
     }
+
+    std::streampos end_pos = this->output.tellp();
+    this->output.seekp(this->count_pos);
+    this->write<uint64_t>(this->num_states);
+    this->output.seekp(end_pos);
+}
+
+void BinaryWriter::accept(const TuringMachine& machine) {
+    this->begin(machine.start_state, machine.accept_state, machine.reject_state);
+
+    for(uint64_t i = 0; i < machine.states.size(); ++i)
+        this->acceptState(i, machine.states[i].def_transition, machine.getTransitions(i), machine.states[i].tape);
+
+    this->finish();
+}
+
+uint64_t BinaryWriter::getNumStates() const {
+    return this->num_states;
+}
+
+uint64_t BinaryWriter::getNumTransitions() const {
+    return this->num_transitions;
 }
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "output/cwriter.hpp"
+#include "exceptions.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+const char* const C_PROLOGUE = R"(#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define INITIAL_TAPE_SIZE 4096
+
+struct tape {
+    uint16_t* data;
+    size_t size;
+    size_t head;
+};
+
+static struct tape tapes[NUM_TAPES];
+static uint64_t total_steps;
+
+static uint16_t* alloc_tape(size_t size) {
+    uint16_t* data = calloc(size, sizeof(uint16_t));
+    if(!data) {
+        fputs("Out of memory\n", stderr);
+        exit(1);
+    }
+    return data;
+}
+
+static uint64_t ensure_margin(struct tape* t) {
+    /* Grows the tape until the head is at least a quarter of its size away from
+       either edge and returns how many moves that leaves before the next check */
+    while(t->head < t->size / 4 || t->size - t->head <= t->size / 4) {
+        size_t old_size = t->size;
+        uint16_t* data = alloc_tape(old_size * 2);
+        memcpy(data + old_size / 2, t->data, old_size * sizeof(uint16_t));
+        free(t->data);
+        t->data = data;
+        t->size = old_size * 2;
+        t->head += old_size / 2;
+    }
+
+    size_t left = t->head;
+    size_t right = t->size - t->head - 1;
+    return left < right ? left : right;
+}
+
+)";
+
+const char* const C_EPILOGUE = R"(
+static void dump_tape(size_t index) {
+    size_t begin = 0;
+    size_t end = tapes[index].size;
+    while(begin < end && tapes[index].data[begin] == 0)
+        ++begin;
+    while(end > begin && tapes[index].data[end - 1] == 0)
+        --end;
+
+    if(index == 0)
+        printf("Tape:");
+    else
+        printf("Tape %zu:", index);
+    for(size_t i = begin; i < end; ++i) {
+        switch(tapes[index].data[i]) {
+            case SYMBOL_BP: printf(" BP"); break;
+            case SYMBOL_AP: printf(" AP"); break;
+            case SYMBOL_TEMP1: printf(" TEMP1"); break;
+            case SYMBOL_GP: printf(" GP"); break;
+            case SYMBOL_TEMP2: printf(" TEMP2"); break;
+            default: printf(" %u", tapes[index].data[i]); break;
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t max_steps = UINT64_MAX;
+    int print_tape = 0;
+    const char* tape_file = NULL;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strncmp(argv[i], "--max-steps=", 12) == 0)
+            max_steps = strtoull(argv[i] + 12, NULL, 10);
+        else if(strcmp(argv[i], "--dump-tape") == 0)
+            print_tape = 1;
+        else if(strncmp(argv[i], "--", 2) == 0) {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else
+            tape_file = argv[i];
+    }
+
+    unsigned char* input = NULL;
+    size_t input_size = 0;
+    if(tape_file) {
+        FILE* file = fopen(tape_file, "rb");
+        if(!file) {
+            fprintf(stderr, "Failed to open tape file %s\n", tape_file);
+            return 1;
+        }
+        fseek(file, 0, SEEK_END);
+        input_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        input = malloc(input_size + 1);
+        if(!input || fread(input, 1, input_size, file) != input_size) {
+            fprintf(stderr, "Failed to read tape file %s\n", tape_file);
+            return 1;
+        }
+        fclose(file);
+    }
+
+    /* The input goes on tape 0, any other tape starts out blank */
+    for(size_t i = 0; i < NUM_TAPES; ++i) {
+        tapes[i].size = INITIAL_TAPE_SIZE;
+        if(i == 0 && input_size * 2 > INITIAL_TAPE_SIZE)
+            tapes[i].size = input_size * 2;
+        tapes[i].head = tapes[i].size / 4;
+        tapes[i].data = alloc_tape(tapes[i].size);
+    }
+    for(size_t i = 0; i < input_size; ++i)
+        tapes[0].data[tapes[0].head + i] = input[i];
+    free(input);
+
+    struct timespec run_start, run_end;
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
+    int result = run(max_steps);
+    clock_gettime(CLOCK_MONOTONIC, &run_end);
+    double run_time = (run_end.tv_sec - run_start.tv_sec) + (run_end.tv_nsec - run_start.tv_nsec) / 1e9;
+
+    static const char* result_names[] = {"accept", "reject", "timeout"};
+    printf("Result: %s\n", result_names[result]);
+    printf("Steps: %llu\n", (unsigned long long)total_steps);
+    printf("Run time: %g s\n", run_time);
+    if(run_time > 0)
+        printf("Speed: %g steps/s\n", total_steps / run_time);
+
+    if(print_tape) {
+        for(size_t i = 0; i < NUM_TAPES; ++i)
+            dump_tape(i);
+    }
+
+    static const int exit_codes[] = {0, 2, 3};
+    return exit_codes[result];
+}
+)";
+
+CWriter::CWriter(std::ostream& output) : output(output) {}
+
+void CWriter::writePrologue(const TuringMachine& machine) {
+    this->output << "/* Generated from a machine with " << machine.states.size() << " states */\n";
+    this->output << "#define NUM_TAPES " << machine.getNumTapes() << "\n";
+    this->output << "#define SYMBOL_BP " << TAPE_BP << "\n";
+    this->output << "#define SYMBOL_AP " << TAPE_AP << "\n";
+    this->output << "#define SYMBOL_TEMP1 " << TAPE_TEMP1 << "\n";
+    this->output << "#define SYMBOL_GP " << TAPE_GP << "\n";
+    this->output << "#define SYMBOL_TEMP2 " << TAPE_TEMP2 << "\n";
+    this->output << C_PROLOGUE;
+
+    // Heads are only checked against the tape edges when the step count reaches a
+    // limit, set so that no head can have left its tape before then. The check goes
+    // through a dispatch on the state number, which keeps it out of the state code.
+    size_t num_tapes = machine.getNumTapes();
+    this->output << "static int run(uint64_t max_steps) {\n";
+    this->output << "    uint64_t steps = 0, limit = 0;\n";
+    this->output << "    size_t state = " << machine.start_state << ";\n";
+    this->output << "    int result = 1;\n";
+    for(size_t i = 0; i < num_tapes; ++i)
+        this->output << "    uint16_t* d" << i << " = tapes[" << i << "].data; size_t h" << i << " = tapes[" << i << "].head;\n";
+    this->output << "    goto check;\n";
+}
+
+void CWriter::writeAction(size_t tape, const TuringTransition& trans, size_t symbol) {
+    if(trans.output != TRANS_WILDCARD && trans.output != symbol)
+        this->output << " d" << tape << "[h" << tape << "] = " << trans.output << ";";
+
+    if(trans.dir == TuringDirection::LEFT)
+        this->output << " --h" << tape << ";";
+    else if(trans.dir == TuringDirection::RIGHT)
+        this->output << " ++h" << tape << ";";
+
+    this->output << " goto s" << trans.next_state << ";\n";
+}
+
+void CWriter::writeState(const TuringMachine& machine, size_t state) {
+    this->output << "s" << state << ":\n";
+    if(state == machine.accept_state) {
+        this->output << "    result = 0; goto done;\n";
+        return;
+    }
+    if(state == machine.reject_state) {
+        this->output << "    result = 1; goto done;\n";
+        return;
+    }
+
+    const TuringState& info = machine.states[state];
+    TuringTransition def_transition = unpack_transition(info.def_transition);
+    if(def_transition.next_state >= machine.states.size())
+        throw ProgramException("Default transition of state ", state, " leads to unknown state ", def_transition.next_state);
+
+    this->output << "    if(steps == limit) { state = " << state << "; goto check; }\n";
+    this->output << "    ++steps;\n";
+
+    auto transitions = machine.getTransitions(state);
+    if(transitions.empty()) {
+        this->output << "   ";
+        this->writeAction(info.tape, def_transition, TRANS_WILDCARD);
+        return;
+    }
+
+    // The first matching explicit transition wins, later ones on the same input are dead
+    std::vector<bool> seen(TAPE_SYMBOLS, false);
+    this->output << "    switch(d" << info.tape << "[h" << info.tape << "]) {\n";
+    for(const PackedTransition& packed : transitions) {
+        TuringTransition trans = unpack_transition(packed);
+        if(trans.input >= TAPE_SYMBOLS)
+            throw ProgramException("Transition on unknown symbol ", trans.input, " in state ", state);
+        if(trans.next_state >= machine.states.size())
+            throw ProgramException("Transition of state ", state, " leads to unknown state ", trans.next_state);
+        if(seen[trans.input])
+            continue;
+        seen[trans.input] = true;
+
+        this->output << "    case " << trans.input << ":";
+        this->writeAction(info.tape, trans, trans.input);
+    }
+    this->output << "    default:";
+    this->writeAction(info.tape, def_transition, TRANS_WILDCARD);
+    this->output << "    }\n";
+}
+
+void CWriter::writeEpilogue(const TuringMachine& machine) {
+    size_t num_tapes = machine.getNumTapes();
+    auto sync_tapes = [&]() {
+        for(size_t i = 0; i < num_tapes; ++i)
+            this->output << "    tapes[" << i << "].head = h" << i << ";\n";
+    };
+    auto load_tapes = [&]() {
+        for(size_t i = 0; i < num_tapes; ++i)
+            this->output << "    d" << i << " = tapes[" << i << "].data; h" << i << " = tapes[" << i << "].head;\n";
+    };
+
+    this->output << "check:\n";
+    this->output << "    if(steps == max_steps && state != " << machine.accept_state << " && state != " << machine.reject_state << ") {\n";
+    this->output << "        result = 2;\n";
+    this->output << "        goto done;\n";
+    this->output << "    }\n";
+    sync_tapes();
+    this->output << "    limit = max_steps - steps;\n";
+    this->output << "    for(size_t i = 0; i < NUM_TAPES; ++i) {\n";
+    this->output << "        uint64_t margin = ensure_margin(&tapes[i]);\n";
+    this->output << "        if(margin < limit)\n";
+    this->output << "            limit = margin;\n";
+    this->output << "    }\n";
+    this->output << "    limit += steps;\n";
+    load_tapes();
+    this->output << "    switch(state) {\n";
+    for(size_t i = 0; i < machine.states.size(); ++i)
+        this->output << "    case " << i << ": goto s" << i << ";\n";
+    this->output << "    }\n";
+
+    this->output << "done:\n";
+    sync_tapes();
+    this->output << "    total_steps = steps;\n";
+    this->output << "    return result;\n";
+    this->output << "}\n";
+    this->output << C_EPILOGUE;
+}
+
+void CWriter::accept(const TuringMachine& machine) {
+    this->writePrologue(machine);
+    for(size_t i = 0; i < machine.states.size(); ++i)
+        this->writeState(machine, i);
+    this->writeEpilogue(machine);
+}
+
+void compile_c_source(const std::string& source_file, const std::string& output_file) {
+    // Uses the C compiler and flags named by CC and CFLAGS, like make does. Optimizers
+    // slow down a lot on one function with a label per state, so the default stays at -O1.
+    const char* compiler = std::getenv("CC");
+    const char* flags = std::getenv("CFLAGS");
+    std::string command = utils_make_str(compiler ? compiler : "cc", " ", flags ? flags : "-O1", " -o '", output_file, "' '", source_file, "'");
+    if(std::system(command.c_str()) != 0)
+        throw ProgramException("Failed to compile ", source_file, " with: ", command);
+}
\ No newline at end of file
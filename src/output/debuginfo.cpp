@@ -0,0 +1,108 @@
+#include "output/debuginfo.hpp"
+#include "exceptions.hpp"
+
+#include <fstream>
+#include <iostream>
+
+inline void write_varint(std::ostream& output, uint64_t value) {
+    while(value >= 0x80) {
+        output.put((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    output.put(value);
+}
+
+inline uint64_t read_varint(std::istream& input) {
+    uint64_t value = 0;
+    for(size_t shift = 0; shift < 64; shift += 7) {
+        int byte = input.get();
+        if(byte == std::char_traits<char>::eof())
+            throw ParseException("Unexpected end of debug file");
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0)
+            return value;
+    }
+    throw ParseException("Malformed varint in debug file");
+}
+
+DebugInfo make_debug_info(const std::string& source, const std::vector<Instr>& instrs, const std::vector<uint32_t>& state_ips) {
+    DebugInfo info;
+    info.source = source;
+    info.instrs.reserve(instrs.size());
+    for(const Instr& instr : instrs)
+        info.instrs.push_back({instr.opcode, static_cast<uint32_t>(instr.line)});
+    info.state_ips = state_ips;
+    return info;
+}
+
+std::string debug_info_path(const std::string& machine_path) {
+    return machine_path + ".dbg";
+}
+
+void write_debug_info(const std::string& path, const DebugInfo& info) {
+    std::ofstream output(path, std::ofstream::binary);
+    if(!output)
+        throw ProgramException("Failed to create debug file ", path);
+
+    uint32_t header[] = {DEBUG_MAGIC, DEBUG_VERSION};
+    output.write((const char*)header, sizeof(header));
+
+    write_varint(output, info.source.size());
+    output.write(info.source.data(), info.source.size());
+
+    write_varint(output, info.instrs.size());
+    for(const DebugInstr& instr : info.instrs) {
+        write_varint(output, static_cast<uint64_t>(instr.opcode));
+        write_varint(output, instr.line);
+    }
+
+    // States are created instruction by instruction, so the map is stored as runs of
+    // (length, IP + 1) with 0 standing for NO_IP
+    write_varint(output, info.state_ips.size());
+    for(size_t i = 0; i < info.state_ips.size();) {
+        size_t end = i + 1;
+        while(end < info.state_ips.size() && info.state_ips[end] == info.state_ips[i])
+            ++end;
+        write_varint(output, end - i);
+        write_varint(output, info.state_ips[i] == NO_IP ? 0 : uint64_t(info.state_ips[i]) + 1);
+        i = end;
+    }
+}
+
+DebugInfo read_debug_info(const std::string& path) {
+    std::ifstream input(path, std::ifstream::binary);
+    if(!input)
+        throw ProgramException("Failed to open debug file ", path);
+
+    uint32_t header[2];
+    input.read((char*)header, sizeof(header));
+    if(!input || header[0] != DEBUG_MAGIC)
+        throw ParseException(path, " is not a debug file");
+    if(header[1] != DEBUG_VERSION)
+        throw ParseException("Unsupported debug file version ", header[1]);
+
+    DebugInfo info;
+    info.source.resize(read_varint(input));
+    input.read(info.source.data(), info.source.size());
+
+    info.instrs.resize(read_varint(input));
+    for(DebugInstr& instr : info.instrs) {
+        uint64_t opcode = read_varint(input);
+        if(opcode >= NUM_OPCODES)
+            throw ParseException("Unknown opcode ", opcode, " in debug file");
+        instr.opcode = static_cast<Opcode>(opcode);
+        instr.line = read_varint(input);
+    }
+
+    uint64_t num_states = read_varint(input);
+    info.state_ips.reserve(num_states);
+    while(info.state_ips.size() < num_states) {
+        uint64_t length = read_varint(input);
+        uint64_t ip = read_varint(input);
+        if(length == 0 || length > num_states - info.state_ips.size() || ip > info.instrs.size())
+            throw ParseException("Malformed state map in debug file");
+        info.state_ips.insert(info.state_ips.end(), length, ip == 0 ? NO_IP : uint32_t(ip - 1));
+    }
+
+    return info;
+}
\ No newline at end of file
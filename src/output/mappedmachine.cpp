@@ -0,0 +1,111 @@
+#include "output/mappedmachine.hpp"
+#include "output/binarywriter.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedMachine::MappedMachine(const std::string& path) : data(nullptr), size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw ProgramException("Failed to open machine file ", path);
+
+    struct stat info;
+    if(fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(MappedHeader)) {
+        close(fd);
+        throw ParseException("Machine file ", path, " is too small to be mapped");
+    }
+
+    this->size = info.st_size;
+    this->data = mmap(nullptr, this->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if(this->data == MAP_FAILED)
+        throw ProgramException("Failed to map machine file ", path);
+
+    // Only the layout is checked here, the tables themselves are used as they are
+    const char* base = static_cast<const char*>(this->data);
+    this->header = reinterpret_cast<const MappedHeader*>(base);
+
+    auto fail = [&](const char* reason) {
+        munmap(this->data, this->size);
+        throw ParseException("Invalid mapped machine ", path, ": ", reason);
+    };
+
+    if(this->header->magic != MACHINE_MAGIC || this->header->version != MAPPED_VERSION)
+        fail("bad magic or version");
+
+    uint64_t num_states = this->header->num_states;
+    uint64_t num_transitions = this->header->num_transitions;
+    if(this->header->transitions_offset % alignof(PackedTransition) != 0 || this->header->states_offset % alignof(TuringState) != 0)
+        fail("misaligned tables");
+    if(this->header->transitions_offset > this->size || (this->size - this->header->transitions_offset) / sizeof(PackedTransition) < num_transitions)
+        fail("transition table out of bounds");
+    if(this->header->states_offset > this->size || (this->size - this->header->states_offset) / sizeof(TuringState) < num_states)
+        fail("state table out of bounds");
+    if(this->header->start_state >= num_states || this->header->accept_state >= num_states || this->header->reject_state >= num_states)
+        fail("header references unknown state");
+
+    this->states = reinterpret_cast<const TuringState*>(base + this->header->states_offset);
+    this->transitions = reinterpret_cast<const PackedTransition*>(base + this->header->transitions_offset);
+
+    this->num_tapes = 1;
+    for(uint64_t i = 0; i < num_states; ++i) {
+        const TuringState& state = this->states[i];
+        if(state.first_transition > num_transitions || num_transitions - state.first_transition < state.num_transitions)
+            fail("state transitions out of bounds");
+        if(state.tape >= MAX_TAPES)
+            fail("state on unknown tape");
+        this->num_tapes = std::max<size_t>(this->num_tapes, state.tape + 1);
+    }
+}
+
+MappedMachine::~MappedMachine() {
+    munmap(this->data, this->size);
+}
+
+size_t MappedMachine::getStartState() const {
+    return this->header->start_state;
+}
+
+size_t MappedMachine::getAcceptState() const {
+    return this->header->accept_state;
+}
+
+size_t MappedMachine::getRejectState() const {
+    return this->header->reject_state;
+}
+
+size_t MappedMachine::getNumStates() const {
+    return this->header->num_states;
+}
+
+size_t MappedMachine::getNumTapes() const {
+    return this->num_tapes;
+}
+
+const TuringState* MappedMachine::getStates() const {
+    return this->states;
+}
+
+const PackedTransition* MappedMachine::getTransitionArena() const {
+    return this->transitions;
+}
+
+std::span<const PackedTransition> MappedMachine::getTransitions(size_t state) const {
+    const TuringState& info = this->states[state];
+    return std::span<const PackedTransition>(this->transitions + info.first_transition, info.num_transitions);
+}
+
+bool MappedMachine::isMapped(const std::string& path) {
+    std::ifstream input(path, std::ifstream::binary);
+    uint32_t magic[2];
+    if(!input.read((char*)magic, sizeof(magic)))
+        return false;
+    return magic[0] == MACHINE_MAGIC && magic[1] == MAPPED_VERSION;
+}
\ No newline at end of file
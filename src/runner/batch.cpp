@@ -0,0 +1,89 @@
+#include "runner/batch.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+std::vector<std::string> read_batch_inputs(const std::string& path) {
+    // A directory runs every file in it in name order, anything else is a manifest with
+    // one tape file per line, relative to the directory of the manifest
+    std::vector<std::string> result;
+    if(std::filesystem::is_directory(path)) {
+        for(const auto& entry : std::filesystem::directory_iterator(path)) {
+            if(entry.is_regular_file())
+                result.push_back(entry.path().string());
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::ifstream manifest(path);
+    if(!manifest)
+        throw ProgramException("Failed to open batch manifest ", path);
+
+    std::filesystem::path base = std::filesystem::path(path).parent_path();
+    std::string line;
+    while(std::getline(manifest, line)) {
+        line = utils_trim(line);
+        if(!line.empty())
+            result.push_back((base / line).string());
+    }
+    return result;
+}
+
+std::vector<BatchResult> run_batch(const TuringSimulator& prototype, const std::vector<std::string>& inputs, size_t num_threads, uint64_t max_steps) {
+    // Every worker runs on a copy of the prototype, which shares its tables and reuses
+    // its own tapes between runs. Inputs are handed out one at a time in order.
+    std::vector<BatchResult> results(inputs.size());
+    std::atomic<size_t> next_input(0);
+    num_threads = std::max<size_t>(1, std::min(num_threads, inputs.size()));
+
+    auto worker = [&]() {
+        TuringSimulator simulator = prototype;
+        for(size_t i = next_input++; i < inputs.size(); i = next_input++) {
+            simulator.reset(read_tape_file(inputs[i]));
+            results[i].result = simulator.run(max_steps);
+            results[i].steps = simulator.getSteps();
+        }
+    };
+
+    if(num_threads == 1) {
+        worker();
+        return results;
+    }
+
+    std::vector<std::exception_ptr> errors(num_threads);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            try {
+                worker();
+            }
+            catch(...) {
+                errors[t] = std::current_exception();
+                // Let the other workers run out of inputs
+                next_input = inputs.size();
+            }
+        });
+    }
+    for(std::thread& thread : threads)
+        thread.join();
+    for(const std::exception_ptr& error : errors) {
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    return results;
+}
+
+void write_batch_results(std::ostream& output, const std::vector<std::string>& inputs, const std::vector<BatchResult>& results) {
+    // One line per tape in input order: result, step count and tape file
+    for(size_t i = 0; i < results.size(); ++i)
+        output << results[i].result << " " << results[i].steps << " " << inputs[i] << "\n";
+    output.flush();
+}
\ No newline at end of file
@@ -0,0 +1,634 @@
+#include "runner/instrvm.hpp"
+#include "exceptions.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+const size_t NO_MARKER = std::numeric_limits<size_t>::max();
+
+inline size_t op_bytes(Opcode op, Opcode base) {
+    return size_t(1) << (static_cast<size_t>(op) - static_cast<size_t>(base));
+}
+
+InstrVM::InstrVM(const Instr* instr, size_t num_instr) : instr(instr), num_instr(num_instr) {
+    // Return ids are handed out to CALLs in program order, like TuringCompiler::analyzeJumps
+    this->return_ids.assign(num_instr, 0);
+    for(size_t i = 0; i < num_instr; ++i) {
+        if(instr[i].opcode == Opcode::CALL) {
+            this->return_ids[i] = this->return_ips.size();
+            this->return_ips.push_back(i + 1);
+        }
+    }
+    this->reset({});
+}
+
+void InstrVM::reset(const std::vector<uint8_t>& input) {
+    // The start state overwrites the first input cell with GP
+    this->tape.assign(input.begin(), input.end());
+    this->cell(0) = TAPE_GP;
+    this->head = 1;
+    this->ip = 0;
+    this->steps = 0;
+}
+
+uint16_t& InstrVM::cell(size_t pos) {
+    if(pos >= this->tape.size())
+        this->tape.resize(std::max(pos + 1, this->tape.size() * 2), 0);
+    return this->tape[pos];
+}
+
+size_t InstrVM::left(size_t pos, size_t distance) {
+    if(distance > pos)
+        throw ProgramException("Instruction ", this->ip, " moves off the start of the tape");
+    return pos - distance;
+}
+
+size_t InstrVM::findMarker(size_t pos, size_t token) {
+    // Searches left from pos itself, the marker closest to it wins
+    for(size_t i = std::min(pos + 1, this->tape.size()); i > 0; --i) {
+        if(this->tape[i-1] == token)
+            return i-1;
+    }
+    return NO_MARKER;
+}
+
+bool InstrVM::readByte(size_t pos, uint8_t& value) {
+    uint16_t symbol = this->cell(pos);
+    if(symbol >= 256)
+        return false;
+    value = symbol;
+    return true;
+}
+
+bool InstrVM::readValue(size_t pos, size_t bytes, uint32_t& value) {
+    value = 0;
+    for(size_t i = 0; i < bytes; ++i) {
+        uint8_t byte;
+        if(!this->readByte(pos + i, byte))
+            return false;
+        value |= uint32_t(byte) << (8 * i);
+    }
+    return true;
+}
+
+void InstrVM::writeValue(size_t pos, size_t bytes, uint32_t value) {
+    for(size_t i = 0; i < bytes; ++i)
+        this->cell(pos + i) = (value >> (8 * i)) & 0xFF;
+}
+
+StepResult InstrVM::execLoad(size_t bytes, size_t offset, size_t base_token) {
+    for(size_t j = 0; j < bytes; ++j) {
+        this->cell(this->head) = TAPE_TEMP1;
+        size_t base = this->findMarker(this->left(this->head, 1), base_token);
+        if(base == NO_MARKER)
+            return StepResult::HANG;
+
+        // Reading the TEMP1 mark fails, going past it never finds it again
+        size_t source = base + 1 + offset + j;
+        if(source > this->head)
+            return StepResult::HANG;
+
+        uint8_t value;
+        if(!this->readByte(source, value))
+            return StepResult::REJECT;
+        this->cell(this->head++) = value;
+    }
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::execStore(size_t bytes, size_t offset, size_t base_token) {
+    for(size_t k = 0; k < bytes; ++k) {
+        this->cell(this->head) = 0;
+        size_t top = this->left(this->head, 1);
+
+        uint8_t value;
+        if(!this->readByte(top, value))
+            return StepResult::REJECT;
+        this->cell(top) = TAPE_TEMP1;
+
+        size_t base = this->findMarker(this->left(top, 1), base_token);
+        if(base == NO_MARKER)
+            return StepResult::HANG;
+
+        // The way back looks for the TEMP1 mark to the right of the destination
+        size_t dest = base + 1 + offset + (bytes - k - 1);
+        if(dest >= top)
+            return StepResult::HANG;
+
+        this->cell(dest) = value;
+        this->cell(top) = 0;
+        this->head = top;
+    }
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::popIndex(size_t max_ind, size_t& index) {
+    // Indices past the end are rejected like the lowerings do
+    size_t begin = this->left(this->head, 4);
+    uint32_t value;
+    if(!this->readValue(begin, 4, value) || value >= max_ind)
+        return StepResult::REJECT;
+
+    for(size_t i = begin; i <= this->head; ++i)
+        this->cell(i) = 0;
+    this->head = begin;
+    index = value;
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::execBinary(Opcode op, size_t bytes) {
+    size_t rhs_pos = this->left(this->head, bytes);
+    size_t lhs_pos = this->left(rhs_pos, bytes);
+
+    uint32_t lhs, rhs;
+    if(!this->readValue(lhs_pos, bytes, lhs) || !this->readValue(rhs_pos, bytes, rhs))
+        return StepResult::REJECT;
+
+    uint32_t result = 0;
+    switch(op) {
+        case Opcode::ADD8:
+            result = lhs + rhs;
+            break;
+        case Opcode::SUB8:
+            result = lhs - rhs;
+            break;
+        case Opcode::AND8:
+            result = lhs & rhs;
+            break;
+        case Opcode::OR8:
+            result = lhs | rhs;
+            break;
+        case Opcode::XOR8:
+            result = lhs ^ rhs;
+            break;
+        default:
+            throw ProgramException("Opcode ", op, " is not a binary operation");
+    }
+
+    this->writeValue(lhs_pos, bytes, result);
+    this->writeValue(rhs_pos, bytes, 0);
+    this->head = rhs_pos;
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::findVariable(size_t offset, size_t base_token, size_t& pos) {
+    // The fused instructions mark the head with TEMP1 and walk back to it afterwards
+    this->cell(this->head) = TAPE_TEMP1;
+    size_t base = this->findMarker(this->left(this->head, 1), base_token);
+    if(base == NO_MARKER)
+        return StepResult::HANG;
+
+    pos = base + 1 + offset;
+    if(pos > this->head)
+        return StepResult::HANG;
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::execUpdate(Opcode op, size_t bytes, size_t offset, size_t base_token, uint32_t operand) {
+    size_t pos;
+    StepResult result = this->findVariable(offset, base_token, pos);
+    if(result != StepResult::NEXT)
+        return result;
+
+    uint32_t value;
+    if(!this->readValue(pos, bytes, value))
+        return StepResult::REJECT;
+
+    switch(op) {
+        case Opcode::ADD8:
+            value += operand;
+            break;
+        case Opcode::SUB8:
+            value -= operand;
+            break;
+        case Opcode::XOR8:
+            value ^= operand;
+            break;
+        default:
+            throw ProgramException("Opcode ", op, " is not a fused operation");
+    }
+
+    this->writeValue(pos, bytes, value);
+    this->cell(this->head) = 0;
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::execCall(size_t return_id) {
+    // Each byte of the return id goes where AP was, with AP and the arguments moving
+    // one cell right into the TEMP1 mark at the head
+    for(size_t i = 0; i < 2; ++i) {
+        this->cell(this->head) = TAPE_TEMP1;
+        size_t ap = this->findMarker(this->left(this->head, 1), TAPE_AP);
+        if(ap == NO_MARKER)
+            return StepResult::HANG;
+
+        this->cell(ap) = (return_id >> (8 * i)) & 0xFF;
+        uint16_t carry = TAPE_AP;
+        size_t pos = ap + 1;
+        for(; this->cell(pos) != TAPE_TEMP1; ++pos) {
+            uint8_t value;
+            if(!this->readByte(pos, value))
+                return StepResult::REJECT;
+            this->cell(pos) = carry;
+            carry = value;
+        }
+        this->cell(pos) = carry;
+        this->head = pos + 1;
+    }
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::execRet() {
+    size_t ap = this->findMarker(this->head, TAPE_AP);
+    if(ap == NO_MARKER)
+        return StepResult::HANG;
+
+    for(size_t i = ap; i <= this->head; ++i)
+        this->cell(i) = 0;
+
+    size_t id_pos = this->left(ap, 2);
+    uint32_t return_id;
+    if(!this->readValue(id_pos, 2, return_id) || return_id >= this->return_ips.size())
+        return StepResult::REJECT;
+
+    this->writeValue(id_pos, 2, 0);
+    this->head = id_pos;
+    this->ip = this->return_ips[return_id];
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::execSetRet(size_t bytes) {
+    // The top byte goes just below the return id, the rest below that
+    for(size_t i = 0; i < bytes; ++i) {
+        this->cell(this->head) = 0;
+        size_t top = this->left(this->head, 1);
+
+        uint8_t value;
+        if(!this->readByte(top, value))
+            return StepResult::REJECT;
+        this->cell(top) = TAPE_TEMP1;
+
+        size_t ap = this->findMarker(this->left(top, 1), TAPE_AP);
+        if(ap == NO_MARKER)
+            return StepResult::HANG;
+
+        this->cell(this->left(ap, 3 + i)) = value;
+        this->cell(top) = 0;
+        this->head = top;
+    }
+    return StepResult::NEXT;
+}
+
+StepResult InstrVM::exec(const Instr& in) {
+    size_t next_ip = this->ip + 1;
+    StepResult result = StepResult::NEXT;
+    size_t index;
+
+    switch(in.opcode) {
+        case Opcode::PUSH8:
+        case Opcode::PUSH16:
+        case Opcode::PUSH32: {
+            size_t bytes = op_bytes(in.opcode, Opcode::PUSH8);
+            this->writeValue(this->head, bytes, in.integer);
+            this->head += bytes;
+            break;
+        }
+        case Opcode::POP8:
+        case Opcode::POP16:
+        case Opcode::POP32: {
+            // Clears the head and the cells above the new head, which keeps its byte
+            size_t bytes = op_bytes(in.opcode, Opcode::POP8);
+            size_t new_head = this->left(this->head, bytes);
+            for(size_t i = new_head + 1; i <= this->head; ++i)
+                this->cell(i) = 0;
+            this->head = new_head;
+            break;
+        }
+        case Opcode::DUP8:
+        case Opcode::DUP16:
+        case Opcode::DUP32: {
+            size_t bytes = op_bytes(in.opcode, Opcode::DUP8);
+            size_t source = this->left(this->head, bytes);
+            for(size_t i = 0; i < bytes; ++i) {
+                uint8_t value;
+                if(!this->readByte(source + i, value))
+                    return StepResult::REJECT;
+                this->cell(this->head++) = value;
+            }
+            break;
+        }
+        case Opcode::SWAP8:
+        case Opcode::SWAP16:
+        case Opcode::SWAP32: {
+            size_t bytes = op_bytes(in.opcode, Opcode::SWAP8);
+            size_t top = this->left(this->head, bytes);
+            size_t other = this->left(top, bytes + in.integer);
+            for(size_t i = 0; i < bytes; ++i) {
+                uint8_t a, b;
+                if(!this->readByte(top + i, a) || !this->readByte(other + i, b))
+                    return StepResult::REJECT;
+                this->cell(top + i) = b;
+                this->cell(other + i) = a;
+            }
+            break;
+        }
+        case Opcode::ENTER:
+            this->cell(this->head++) = TAPE_BP;
+            break;
+        case Opcode::ALLOC:
+            this->writeValue(this->head, in.integer, 0);
+            this->head += in.integer;
+            break;
+        case Opcode::FREE: {
+            size_t new_head = this->left(this->head, in.integer);
+            for(size_t i = new_head; i <= this->head; ++i)
+                this->cell(i) = 0;
+            this->head = new_head;
+            break;
+        }
+
+        case Opcode::GETLOCAL8:
+        case Opcode::GETLOCAL16:
+        case Opcode::GETLOCAL32:
+            result = this->execLoad(op_bytes(in.opcode, Opcode::GETLOCAL8), in.integer, TAPE_BP);
+            break;
+        case Opcode::GETARG8:
+        case Opcode::GETARG16:
+        case Opcode::GETARG32:
+            result = this->execLoad(op_bytes(in.opcode, Opcode::GETARG8), in.integer, TAPE_AP);
+            break;
+        case Opcode::GETGLOBAL8:
+        case Opcode::GETGLOBAL16:
+        case Opcode::GETGLOBAL32:
+            result = this->execLoad(op_bytes(in.opcode, Opcode::GETGLOBAL8), in.integer, TAPE_GP);
+            break;
+        case Opcode::SETLOCAL8:
+        case Opcode::SETLOCAL16:
+        case Opcode::SETLOCAL32:
+            result = this->execStore(op_bytes(in.opcode, Opcode::SETLOCAL8), in.integer, TAPE_BP);
+            break;
+        case Opcode::SETARG8:
+        case Opcode::SETARG16:
+        case Opcode::SETARG32:
+            result = this->execStore(op_bytes(in.opcode, Opcode::SETARG8), in.integer, TAPE_AP);
+            break;
+        case Opcode::SETGLOBAL8:
+        case Opcode::SETGLOBAL16:
+        case Opcode::SETGLOBAL32:
+            result = this->execStore(op_bytes(in.opcode, Opcode::SETGLOBAL8), in.integer, TAPE_GP);
+            break;
+
+        case Opcode::GETLOCALIND8:
+        case Opcode::GETLOCALIND16:
+        case Opcode::GETLOCALIND32:
+            result = this->popIndex(in.integer2, index);
+            if(result == StepResult::NEXT)
+                result = this->execLoad(op_bytes(in.opcode, Opcode::GETLOCALIND8), in.integer + index, TAPE_BP);
+            break;
+        case Opcode::GETARGIND8:
+        case Opcode::GETARGIND16:
+        case Opcode::GETARGIND32:
+            result = this->popIndex(in.integer2, index);
+            if(result == StepResult::NEXT)
+                result = this->execLoad(op_bytes(in.opcode, Opcode::GETARGIND8), in.integer + index, TAPE_AP);
+            break;
+        case Opcode::GETGLOBALIND8:
+        case Opcode::GETGLOBALIND16:
+        case Opcode::GETGLOBALIND32:
+            result = this->popIndex(in.integer2, index);
+            if(result == StepResult::NEXT)
+                result = this->execLoad(op_bytes(in.opcode, Opcode::GETGLOBALIND8), in.integer + index, TAPE_GP);
+            break;
+        case Opcode::SETLOCALIND8:
+        case Opcode::SETLOCALIND16:
+        case Opcode::SETLOCALIND32:
+            result = this->popIndex(in.integer2, index);
+            if(result == StepResult::NEXT)
+                result = this->execStore(op_bytes(in.opcode, Opcode::SETLOCALIND8), in.integer + index, TAPE_BP);
+            break;
+        case Opcode::SETARGIND8:
+        case Opcode::SETARGIND16:
+        case Opcode::SETARGIND32:
+            result = this->popIndex(in.integer2, index);
+            if(result == StepResult::NEXT)
+                result = this->execStore(op_bytes(in.opcode, Opcode::SETARGIND8), in.integer + index, TAPE_AP);
+            break;
+        case Opcode::SETGLOBALIND8:
+        case Opcode::SETGLOBALIND16:
+        case Opcode::SETGLOBALIND32:
+            result = this->popIndex(in.integer2, index);
+            if(result == StepResult::NEXT)
+                result = this->execStore(op_bytes(in.opcode, Opcode::SETGLOBALIND8), in.integer + index, TAPE_GP);
+            break;
+
+        case Opcode::MAKEARGS: {
+            // AP goes below the arguments, which all move one cell right
+            size_t begin = this->left(this->head, in.integer);
+            uint16_t carry = TAPE_AP;
+            for(size_t i = begin; i < this->head; ++i) {
+                uint8_t value;
+                if(!this->readByte(i, value))
+                    return StepResult::REJECT;
+                this->cell(i) = carry;
+                carry = value;
+            }
+            this->cell(this->head++) = carry;
+            break;
+        }
+
+        case Opcode::ADD8:
+        case Opcode::ADD16:
+        case Opcode::ADD32:
+            result = this->execBinary(Opcode::ADD8, op_bytes(in.opcode, Opcode::ADD8));
+            break;
+        case Opcode::SUB8:
+        case Opcode::SUB16:
+        case Opcode::SUB32:
+            result = this->execBinary(Opcode::SUB8, op_bytes(in.opcode, Opcode::SUB8));
+            break;
+        case Opcode::AND8:
+        case Opcode::AND16:
+        case Opcode::AND32:
+            result = this->execBinary(Opcode::AND8, op_bytes(in.opcode, Opcode::AND8));
+            break;
+        case Opcode::OR8:
+        case Opcode::OR16:
+        case Opcode::OR32:
+            result = this->execBinary(Opcode::OR8, op_bytes(in.opcode, Opcode::OR8));
+            break;
+        case Opcode::XOR8:
+        case Opcode::XOR16:
+        case Opcode::XOR32:
+            result = this->execBinary(Opcode::XOR8, op_bytes(in.opcode, Opcode::XOR8));
+            break;
+
+        case Opcode::ADDLOCAL8:
+        case Opcode::ADDLOCAL16:
+        case Opcode::ADDLOCAL32:
+            result = this->execUpdate(Opcode::ADD8, op_bytes(in.opcode, Opcode::ADDLOCAL8), in.integer, TAPE_BP, in.integer2);
+            break;
+        case Opcode::SUBLOCAL8:
+        case Opcode::SUBLOCAL16:
+        case Opcode::SUBLOCAL32:
+            result = this->execUpdate(Opcode::SUB8, op_bytes(in.opcode, Opcode::SUBLOCAL8), in.integer, TAPE_BP, in.integer2);
+            break;
+        case Opcode::XORLOCAL8:
+        case Opcode::XORLOCAL16:
+        case Opcode::XORLOCAL32:
+            result = this->execUpdate(Opcode::XOR8, op_bytes(in.opcode, Opcode::XORLOCAL8), in.integer, TAPE_BP, in.integer2);
+            break;
+        case Opcode::ADDARG8:
+        case Opcode::ADDARG16:
+        case Opcode::ADDARG32:
+            result = this->execUpdate(Opcode::ADD8, op_bytes(in.opcode, Opcode::ADDARG8), in.integer, TAPE_AP, in.integer2);
+            break;
+        case Opcode::SUBARG8:
+        case Opcode::SUBARG16:
+        case Opcode::SUBARG32:
+            result = this->execUpdate(Opcode::SUB8, op_bytes(in.opcode, Opcode::SUBARG8), in.integer, TAPE_AP, in.integer2);
+            break;
+        case Opcode::XORARG8:
+        case Opcode::XORARG16:
+        case Opcode::XORARG32:
+            result = this->execUpdate(Opcode::XOR8, op_bytes(in.opcode, Opcode::XORARG8), in.integer, TAPE_AP, in.integer2);
+            break;
+        case Opcode::ADDGLOBAL8:
+        case Opcode::ADDGLOBAL16:
+        case Opcode::ADDGLOBAL32:
+            result = this->execUpdate(Opcode::ADD8, op_bytes(in.opcode, Opcode::ADDGLOBAL8), in.integer, TAPE_GP, in.integer2);
+            break;
+        case Opcode::SUBGLOBAL8:
+        case Opcode::SUBGLOBAL16:
+        case Opcode::SUBGLOBAL32:
+            result = this->execUpdate(Opcode::SUB8, op_bytes(in.opcode, Opcode::SUBGLOBAL8), in.integer, TAPE_GP, in.integer2);
+            break;
+        case Opcode::XORGLOBAL8:
+        case Opcode::XORGLOBAL16:
+        case Opcode::XORGLOBAL32:
+            result = this->execUpdate(Opcode::XOR8, op_bytes(in.opcode, Opcode::XORGLOBAL8), in.integer, TAPE_GP, in.integer2);
+            break;
+
+        case Opcode::IDXSHFT: {
+            size_t begin = this->left(this->head, 4);
+            uint32_t value;
+            if(!this->readValue(begin, 4, value))
+                return StepResult::REJECT;
+            this->writeValue(begin, 4, value << in.integer);
+            break;
+        }
+
+        case Opcode::JMP:
+            next_ip = in.integer;
+            break;
+        case Opcode::JF:
+        case Opcode::JT: {
+            // Anything but a zero byte counts as true, markers included
+            size_t cond = this->left(this->head, 1);
+            bool is_true = this->cell(cond) != 0;
+            this->cell(cond) = 0;
+            this->head = cond;
+            if(is_true == (in.opcode == Opcode::JT))
+                next_ip = in.integer;
+            break;
+        }
+        case Opcode::JEQLOCAL8:
+        case Opcode::JEQARG8:
+        case Opcode::JEQGLOBAL8: {
+            size_t base_token = (in.opcode == Opcode::JEQLOCAL8) ? TAPE_BP : (in.opcode == Opcode::JEQARG8) ? TAPE_AP : TAPE_GP;
+            size_t pos;
+            uint8_t value;
+            result = this->findVariable(in.integer2, base_token, pos);
+            if(result != StepResult::NEXT)
+                return result;
+            if(!this->readByte(pos, value))
+                return StepResult::REJECT;
+            this->cell(this->head) = 0;
+            if(value == in.integer3)
+                next_ip = in.integer;
+            break;
+        }
+        case Opcode::CALL:
+            result = this->execCall(this->return_ids[this->ip]);
+            next_ip = in.integer;
+            break;
+        case Opcode::RET:
+            result = this->execRet();
+            next_ip = this->ip;
+            break;
+
+        case Opcode::SETRET8:
+        case Opcode::SETRET16:
+        case Opcode::SETRET32:
+            result = this->execSetRet(op_bytes(in.opcode, Opcode::SETRET8));
+            break;
+
+        case Opcode::ACCEPT:
+            return StepResult::ACCEPT;
+        case Opcode::REJECT:
+            return StepResult::REJECT;
+    }
+
+    this->ip = next_ip;
+    return result;
+}
+
+SimulationResult InstrVM::run(uint64_t max_steps) {
+    while(this->steps < max_steps) {
+        // Running off the end of the program ends in the reject state
+        if(this->ip >= this->num_instr)
+            return SimulationResult::REJECT;
+
+        ++this->steps;
+        switch(this->exec(this->instr[this->ip])) {
+            case StepResult::NEXT:
+                break;
+            case StepResult::ACCEPT:
+                return SimulationResult::ACCEPT;
+            case StepResult::REJECT:
+                return SimulationResult::REJECT;
+            case StepResult::HANG:
+                return SimulationResult::TIMEOUT;
+        }
+    }
+    return SimulationResult::TIMEOUT;
+}
+
+uint64_t InstrVM::getSteps() const {
+    return this->steps;
+}
+
+size_t InstrVM::getHead() const {
+    return this->head;
+}
+
+const std::vector<uint16_t>& InstrVM::getTape() const {
+    return this->tape;
+}
+
+int run_instrs(const std::vector<Instr>& instrs, const std::string& tape_file, uint64_t max_steps, bool dump_tape) {
+    InstrVM vm(instrs.data(), instrs.size());
+    if(!tape_file.empty())
+        vm.reset(read_tape_file(tape_file));
+
+    auto run_start = std::chrono::steady_clock::now();
+    SimulationResult result = vm.run(max_steps);
+    auto run_end = std::chrono::steady_clock::now();
+    double run_time = std::chrono::duration<double>(run_end - run_start).count();
+
+    std::cout << "Result: " << result << std::endl;
+    std::cout << "Instructions: " << vm.getSteps() << std::endl;
+    std::cout << "Run time: " << run_time << " s" << std::endl;
+    if(dump_tape)
+        print_tape(std::cout, vm.getTape(), 0);
+
+    switch(result) {
+        case SimulationResult::ACCEPT:
+            return 0;
+        case SimulationResult::REJECT:
+            return 2;
+        case SimulationResult::TIMEOUT:
+            return 3;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "output/binaryreader.hpp"
+#include "output/mappedmachine.hpp"
+#include "runner/simulator.hpp"
+#include "runner/batch.hpp"
+#include "runner/profile.hpp"
+#include "exceptions.hpp"
+#include "utils.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <thread>
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    uint64_t max_steps = std::numeric_limits<uint64_t>::max();
+    bool dump_tape = false;
+    SimulatorOptions options;
+    std::string batch_path;
+    std::string batch_output;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string debug_path;
+    std::string profile_output;
+    size_t profile_top = 20;
+
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg.rfind("--max-steps=", 0) == 0) {
+            uint64_t value;
+            if(!utils_parse_uint(arg.substr(12), value)) {
+                std::cerr << "Invalid value for --max-steps" << std::endl;
+                return 1;
+            }
+            max_steps = value;
+        }
+        else if(arg == "--dump-tape")
+            dump_tape = true;
+        else if(arg == "--no-fuse")
+            options.fuse = false;
+        else if(arg == "--no-scan")
+            options.scan = false;
+        else if(arg.rfind("--batch=", 0) == 0)
+            batch_path = arg.substr(8);
+        else if(arg.rfind("--batch-output=", 0) == 0)
+            batch_output = arg.substr(15);
+        else if(arg.rfind("--threads=", 0) == 0) {
+            uint64_t value;
+            if(!utils_parse_uint(arg.substr(10), value)) {
+                std::cerr << "Invalid value for --threads" << std::endl;
+                return 1;
+            }
+            threads = value;
+        }
+        else if(arg == "--profile")
+            options.profile = true;
+        else if(arg.rfind("--profile-top=", 0) == 0) {
+            uint64_t value;
+            if(!utils_parse_uint(arg.substr(14), value)) {
+                std::cerr << "Invalid value for --profile-top" << std::endl;
+                return 1;
+            }
+            profile_top = value;
+        }
+        else if(arg.rfind("--profile-output=", 0) == 0) {
+            profile_output = arg.substr(17);
+            options.profile = true;
+        }
+        else if(arg.rfind("--debug-info=", 0) == 0)
+            debug_path = arg.substr(13);
+        else if(arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 1;
+        }
+        else
+            files.push_back(arg);
+    }
+
+    if(files.size() < 1) {
+        std::cerr << "Not enough arguments given" << std::endl;
+        return 1;
+    }
+
+    if(options.profile && !batch_path.empty()) {
+        std::cerr << "--profile cannot be combined with --batch" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(files[0], std::ifstream::binary);
+    if(!input) {
+        std::cerr << "Failed to open machine file " << files[0] << std::endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> tape_input;
+    if(files.size() > 1) {
+        std::ifstream tape_file(files[1], std::ifstream::binary);
+        if(!tape_file) {
+            std::cerr << "Failed to open tape file " << files[1] << std::endl;
+            return 1;
+        }
+        tape_input.assign(std::istreambuf_iterator<char>(tape_file), std::istreambuf_iterator<char>());
+    }
+
+    try {
+        // The profile is reported per instruction and line from the compiler's debug file
+        DebugInfo debug_info;
+        if(options.profile)
+            debug_info = read_debug_info(debug_path.empty() ? debug_info_path(files[0]) : debug_path);
+
+        auto load_start = std::chrono::steady_clock::now();
+
+        // Mapped files are simulated in place, everything else is parsed and lowered
+        std::unique_ptr<MappedMachine> mapped;
+        std::unique_ptr<TuringSimulator> simulator;
+        if(MappedMachine::isMapped(files[0])) {
+            mapped = std::make_unique<MappedMachine>(files[0]);
+            simulator = std::make_unique<TuringSimulator>(*mapped, options);
+        }
+        else {
+            TuringMachine machine = BinaryReader(input).parse();
+            simulator = std::make_unique<TuringSimulator>(machine, options);
+        }
+
+        if(!batch_path.empty()) {
+            std::vector<std::string> inputs = read_batch_inputs(batch_path);
+
+            auto run_start = std::chrono::steady_clock::now();
+            std::vector<BatchResult> results = run_batch(*simulator, inputs, threads, max_steps);
+            auto run_end = std::chrono::steady_clock::now();
+
+            if(batch_output.empty())
+                write_batch_results(std::cout, inputs, results);
+            else {
+                std::ofstream output(batch_output);
+                if(!output) {
+                    std::cerr << "Failed to create file " << batch_output << std::endl;
+                    return 1;
+                }
+                write_batch_results(output, inputs, results);
+            }
+
+            // The summary goes to stderr so the results can be piped on their own
+            double load_time = std::chrono::duration<double>(run_start - load_start).count();
+            double run_time = std::chrono::duration<double>(run_end - run_start).count();
+            uint64_t total_steps = 0;
+            for(const BatchResult& result : results)
+                total_steps += result.steps;
+
+            std::cerr << "Tapes: " << results.size() << std::endl;
+            std::cerr << "Steps: " << total_steps << std::endl;
+            std::cerr << "Load time: " << load_time << " s" << std::endl;
+            std::cerr << "Run time: " << run_time << " s" << std::endl;
+            if(run_time > 0)
+                std::cerr << "Speed: " << (results.size() / run_time) << " tapes/s, " << (total_steps / run_time) << " steps/s" << std::endl;
+            return 0;
+        }
+
+        simulator->reset(tape_input);
+
+        auto run_start = std::chrono::steady_clock::now();
+        SimulationResult result = simulator->run(max_steps);
+        auto run_end = std::chrono::steady_clock::now();
+
+        double load_time = std::chrono::duration<double>(run_start - load_start).count();
+        double run_time = std::chrono::duration<double>(run_end - run_start).count();
+
+        std::cout << "Result: " << result << std::endl;
+        std::cout << "Steps: " << simulator->getSteps() << std::endl;
+        std::cout << "Load time: " << load_time << " s" << std::endl;
+        std::cout << "Run time: " << run_time << " s" << std::endl;
+        if(run_time > 0)
+            std::cout << "Speed: " << (simulator->getSteps() / run_time) << " steps/s" << std::endl;
+
+        if(dump_tape) {
+            for(size_t i = 0; i < simulator->getNumTapes(); ++i)
+                print_tape(std::cout, simulator->getTape(i), i);
+        }
+
+        if(options.profile)
+            print_profile(std::cout, debug_info, simulator->getStateHits(), profile_top);
+
+        if(!profile_output.empty()) {
+            std::ofstream output(profile_output);
+            if(!output) {
+                std::cerr << "Failed to create file " << profile_output << std::endl;
+                return 1;
+            }
+            write_line_profile(output, debug_info, simulator->getStateHits());
+        }
+
+        switch(result) {
+            case SimulationResult::ACCEPT:
+                return 0;
+            case SimulationResult::REJECT:
+                return 2;
+            case SimulationResult::TIMEOUT:
+                return 3;
+        }
+    }
+    catch(const ProgramException& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
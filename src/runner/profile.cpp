@@ -0,0 +1,103 @@
+#include "runner/profile.hpp"
+#include "exceptions.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <utility>
+
+using ProfileEntry = std::pair<size_t, uint64_t>;
+
+inline void sort_profile(std::vector<ProfileEntry>& entries) {
+    std::stable_sort(entries.begin(), entries.end(), [](const ProfileEntry& a, const ProfileEntry& b) {
+        return a.second > b.second;
+    });
+}
+
+inline void print_share(std::ostream& os, uint64_t steps, uint64_t total) {
+    double percent = total > 0 ? 100.0 * steps / total : 0.0;
+    os << std::setw(14) << steps << std::setw(8) << std::fixed << std::setprecision(2) << percent << "%";
+}
+
+std::vector<uint64_t> profile_ips(const DebugInfo& info, const std::vector<uint64_t>& state_hits) {
+    if(state_hits.size() != info.state_ips.size())
+        throw ProgramException("Debug info describes ", info.state_ips.size(), " states, the machine has ", state_hits.size());
+
+    // Start, accept and reject and the shared walks belong to no instruction, they
+    // are collected in an extra entry past the last IP
+    size_t num_instrs = info.instrs.size();
+    std::vector<uint64_t> ip_steps(num_instrs + 1, 0);
+    for(size_t i = 0; i < state_hits.size(); ++i) {
+        uint32_t ip = info.state_ips[i];
+        ip_steps[ip == NO_IP ? num_instrs : ip] += state_hits[i];
+    }
+    return ip_steps;
+}
+
+std::map<size_t, uint64_t> profile_lines(const DebugInfo& info, const std::vector<uint64_t>& ip_steps) {
+    std::map<size_t, uint64_t> line_steps;
+    for(size_t ip = 0; ip < info.instrs.size(); ++ip) {
+        if(ip_steps[ip] != 0)
+            line_steps[info.instrs[ip].line] += ip_steps[ip];
+    }
+    return line_steps;
+}
+
+void print_profile(std::ostream& os, const DebugInfo& info, const std::vector<uint64_t>& state_hits, size_t limit) {
+    size_t num_instrs = info.instrs.size();
+    std::vector<uint64_t> ip_steps = profile_ips(info, state_hits);
+    uint64_t total = 0;
+    for(uint64_t steps : ip_steps)
+        total += steps;
+
+    std::vector<ProfileEntry> by_ip;
+    for(size_t ip = 0; ip <= num_instrs; ++ip) {
+        if(ip_steps[ip] != 0)
+            by_ip.emplace_back(ip, ip_steps[ip]);
+    }
+    std::map<size_t, uint64_t> line_steps = profile_lines(info, ip_steps);
+    std::vector<ProfileEntry> by_line(line_steps.begin(), line_steps.end());
+    sort_profile(by_ip);
+    sort_profile(by_line);
+
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+
+    os << "Profile of " << info.source << ", " << total << " steps" << std::endl;
+    os << "By instruction:" << std::endl;
+    for(size_t i = 0; i < std::min(limit, by_ip.size()); ++i) {
+        print_share(os, by_ip[i].second, total);
+        if(by_ip[i].first == num_instrs) {
+            os << "  (no instruction)" << std::endl;
+            continue;
+        }
+
+        const DebugInstr& instr = info.instrs[by_ip[i].first];
+        os << "  ip " << std::left << std::setw(8) << by_ip[i].first << std::setw(16) << instr.opcode << std::right;
+        if(instr.line != 0)
+            os << "line " << instr.line;
+        os << std::endl;
+    }
+
+    os << "By line:" << std::endl;
+    for(size_t i = 0; i < std::min(limit, by_line.size()); ++i) {
+        print_share(os, by_line[i].second, total);
+        if(by_line[i].first == 0)
+            os << "  (unknown line)" << std::endl;
+        else
+            os << "  line " << by_line[i].first << std::endl;
+    }
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void write_line_profile(std::ostream& os, const DebugInfo& info, const std::vector<uint64_t>& state_hits) {
+    // Lines with a known source line only, in the format read back by turingc --layout-profile
+    for(const auto& line : profile_lines(info, profile_ips(info, state_hits))) {
+        if(line.first != 0)
+            os << line.first << " " << line.second << "\n";
+    }
+    os.flush();
+}
\ No newline at end of file
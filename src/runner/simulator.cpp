@@ -0,0 +1,642 @@
+#include "runner/simulator.hpp"
+#include "exceptions.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <limits>
+#include <bit>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const size_t INITIAL_TAPE_SIZE = 4096;
+const size_t MAX_MACRO_LENGTH = 4096;
+
+inline PackedTransition find_mapped_transition(const TuringState& info, const PackedTransition* first, uint16_t symbol) {
+    // Transitions are sorted by input, a contiguous range is indexed directly
+    uint32_t count = info.num_transitions;
+    if(count == 0 || symbol < first[0].input || symbol > first[count - 1].input)
+        return info.def_transition;
+    if(first[count - 1].input - first[0].input + 1u == count)
+        return first[symbol - first[0].input];
+
+    const PackedTransition* found = std::lower_bound(first, first + count, symbol, [](const PackedTransition& a, uint16_t b) {
+        return a.input < b;
+    });
+    return found->input == symbol ? *found : info.def_transition;
+}
+
+TuringSimulator::TuringSimulator(const TuringMachine& machine, const SimulatorOptions& options) : tables(std::make_shared<SimulatorTables>()) {
+    this->tables->mapped = nullptr;
+    this->lower(machine);
+    this->prepare(machine.states.data(), machine.states.size(), machine.transitions.data(), options);
+    this->reset({});
+}
+
+TuringSimulator::TuringSimulator(const MappedMachine& machine, const SimulatorOptions& options) : tables(std::make_shared<SimulatorTables>()) {
+    // The mapped tables are used in place, so there is nothing to lower
+    this->tables->mapped = &machine;
+    this->tables->start_state = machine.getStartState();
+    this->tables->accept_state = machine.getAcceptState();
+    this->tables->reject_state = machine.getRejectState();
+    this->tables->num_states = machine.getNumStates();
+    this->tables->num_tapes = machine.getNumTapes();
+    this->prepare(machine.getStates(), machine.getNumStates(), machine.getTransitionArena(), options);
+    this->reset({});
+}
+
+void TuringSimulator::lower(const TuringMachine& machine) {
+    if(machine.states.size() > std::numeric_limits<uint32_t>::max())
+        throw ProgramException("Machine has too many states to simulate: ", machine.states.size());
+
+    this->tables->start_state = machine.start_state;
+    this->tables->accept_state = machine.accept_state;
+    this->tables->reject_state = machine.reject_state;
+    this->tables->num_states = machine.states.size();
+    this->tables->num_tapes = machine.getNumTapes();
+
+    auto make_entry = [](const TuringTransition& trans, size_t symbol) {
+        JumpEntry entry;
+        entry.next_state = trans.next_state;
+        entry.output = trans.output == TRANS_WILDCARD ? symbol : trans.output;
+        entry.move = trans.dir == TuringDirection::LEFT ? -1 : trans.dir == TuringDirection::RIGHT ? 1 : 0;
+        return entry;
+    };
+
+    this->tables->table.resize(machine.states.size() * TAPE_SYMBOLS);
+    for(size_t i = 0; i < machine.states.size(); ++i) {
+        auto transitions = machine.getTransitions(i);
+        TuringTransition def_transition = unpack_transition(machine.states[i].def_transition);
+        JumpEntry* row = &this->tables->table[i * TAPE_SYMBOLS];
+
+        for(size_t j = 0; j < TAPE_SYMBOLS; ++j)
+            row[j] = make_entry(def_transition, j);
+
+        // The first matching explicit transition wins, so apply them back to front
+        for(size_t j = transitions.size(); j > 0; --j) {
+            TuringTransition trans = unpack_transition(transitions[j-1]);
+            if(trans.input >= TAPE_SYMBOLS)
+                throw ProgramException("Transition on unknown symbol ", trans.input, " in state ", i);
+            row[trans.input] = make_entry(trans, trans.input);
+        }
+    }
+
+    // Single tape machines do not need to look up the tape of every state
+    this->tables->state_tapes.clear();
+    if(this->tables->num_tapes > 1) {
+        this->tables->state_tapes.resize(machine.states.size());
+        for(size_t i = 0; i < machine.states.size(); ++i)
+            this->tables->state_tapes[i] = machine.states[i].tape;
+    }
+}
+
+void TuringSimulator::prepare(const TuringState* states, size_t num_states, const PackedTransition* transitions, const SimulatorOptions& options) {
+    this->tables->profile = options.profile;
+    this->tables->macros.assign(num_states, MacroStep{});
+    this->tables->scans.assign(num_states, ScanLoop{});
+    if(options.fuse)
+        this->fuseChains(states, num_states, transitions);
+    if(options.scan)
+        this->findScans(states, num_states, transitions);
+}
+
+void TuringSimulator::fuseChains(const TuringState* states, size_t num_states, const PackedTransition* transitions) {
+    // A state without explicit transitions does the same thing whatever it reads, so a chain
+    // of them on one tape can be replayed as a fixed set of writes followed by one move
+    auto is_fusible = [&](size_t state) {
+        return state < num_states && state != this->tables->accept_state && state != this->tables->reject_state
+            && states[state].num_transitions == 0;
+    };
+
+    // Chains are only fused from the states they can be entered at, not from every state
+    // inside them. A chain that hits the length limit continues as a new chain.
+    std::vector<bool> is_entry(num_states, false);
+    std::vector<size_t> worklist;
+    auto add_entry = [&](size_t state) {
+        if(is_fusible(state) && !is_entry[state]) {
+            is_entry[state] = true;
+            worklist.push_back(state);
+        }
+    };
+
+    add_entry(this->tables->start_state);
+    for(size_t i = 0; i < num_states; ++i) {
+        const TuringState& info = states[i];
+        for(uint32_t j = 0; j < info.num_transitions; ++j)
+            add_entry(transitions[info.first_transition + j].next_state);
+
+        size_t next_state = info.def_transition.next_state;
+        if(!is_fusible(i) || (next_state < num_states && states[next_state].tape != info.tape))
+            add_entry(next_state);
+    }
+
+    const int MOVES[] = {0, -1, 1, 0};
+    std::vector<std::pair<int32_t, uint16_t>> writes;
+
+    while(!worklist.empty()) {
+        size_t first_state = worklist.back();
+        worklist.pop_back();
+
+        uint32_t tape = states[first_state].tape;
+        size_t state = first_state;
+        size_t length = 0;
+        int32_t offset = 0;
+        int32_t min_offset = 0;
+        int32_t max_offset = 0;
+        writes.clear();
+
+        while(is_fusible(state) && states[state].tape == tape) {
+            if(length == MAX_MACRO_LENGTH) {
+                add_entry(state);
+                break;
+            }
+
+            PackedTransition trans = states[state].def_transition;
+            if(trans.next_state >= num_states)
+                break;
+            if(trans.output != PACKED_WILDCARD)
+                writes.push_back({offset, uint16_t(trans.output)});
+            offset += MOVES[trans.dir];
+            min_offset = std::min(min_offset, offset);
+            max_offset = std::max(max_offset, offset);
+            state = trans.next_state;
+            ++length;
+        }
+
+        if(length < 2)
+            continue;
+
+        // Only the last write to each cell survives, the rest is grouped into runs of
+        // consecutive cells that can be copied onto the tape at once
+        std::stable_sort(writes.begin(), writes.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+
+        MacroStep& macro = this->tables->macros[first_state];
+        macro.next_state = state;
+        macro.length = length;
+        macro.move = offset;
+        macro.min_offset = min_offset;
+        macro.max_offset = max_offset;
+        macro.first_run = this->tables->macro_runs.size();
+
+        for(size_t i = 0; i < writes.size(); ++i) {
+            if(i + 1 < writes.size() && writes[i + 1].first == writes[i].first)
+                continue;
+
+            if(this->tables->macro_runs.size() == macro.first_run || this->tables->macro_runs.back().offset + int32_t(this->tables->macro_runs.back().length) != writes[i].first)
+                this->tables->macro_runs.push_back({writes[i].first, uint32_t(this->tables->macro_symbols.size()), 0});
+            this->tables->macro_symbols.push_back(writes[i].second);
+            ++this->tables->macro_runs.back().length;
+        }
+        macro.num_runs = this->tables->macro_runs.size() - macro.first_run;
+    }
+}
+
+void TuringSimulator::findScans(const TuringState* states, size_t num_states, const PackedTransition* transitions) {
+    // The walks to a marker are states that loop to themselves without writing and only
+    // leave on a handful of symbols, like the searches for the base token or TEMP1
+    for(size_t i = 0; i < num_states; ++i) {
+        const TuringState& info = states[i];
+        PackedTransition def_transition = info.def_transition;
+        TuringDirection dir = static_cast<TuringDirection>(def_transition.dir);
+
+        if(i == this->tables->accept_state || i == this->tables->reject_state)
+            continue;
+        if(def_transition.next_state != i || def_transition.output != PACKED_WILDCARD)
+            continue;
+        if(dir != TuringDirection::LEFT && dir != TuringDirection::RIGHT)
+            continue;
+        if(info.num_transitions == 0 || info.num_transitions > MAX_SCAN_STOPS)
+            continue;
+
+        ScanLoop& scan = this->tables->scans[i];
+        for(uint32_t j = 0; j < info.num_transitions; ++j)
+            scan.stops[j] = transitions[info.first_transition + j].input;
+        // Unused slots repeat a stop, so the scan can always compare against all of them
+        for(uint32_t j = info.num_transitions; j < MAX_SCAN_STOPS; ++j)
+            scan.stops[j] = scan.stops[0];
+        scan.num_stops = info.num_transitions;
+        scan.move = dir == TuringDirection::LEFT ? -1 : 1;
+    }
+}
+
+uint64_t TuringSimulator::applyScan(const ScanLoop& scan, const uint16_t* tape, size_t tape_size, size_t& head, uint64_t max_distance) {
+    // Counts the cells before the next stop symbol, at most max_distance and never past the
+    // edge of the tape. Stopping just past the edge lets the caller grow the tape as usual.
+    auto is_stop = [&](uint16_t symbol) {
+        return symbol == scan.stops[0] || symbol == scan.stops[1] || symbol == scan.stops[2] || symbol == scan.stops[3];
+    };
+
+    uint64_t distance = 0;
+    if(scan.move > 0) {
+        max_distance = std::min<uint64_t>(max_distance, tape_size - head);
+#ifdef __SSE2__
+        __m128i stops[MAX_SCAN_STOPS];
+        for(size_t i = 0; i < MAX_SCAN_STOPS; ++i)
+            stops[i] = _mm_set1_epi16(scan.stops[i]);
+
+        while(distance + 8 <= max_distance) {
+            __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tape + head + distance));
+            __m128i found = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi16(cells, stops[0]), _mm_cmpeq_epi16(cells, stops[1])),
+                _mm_or_si128(_mm_cmpeq_epi16(cells, stops[2]), _mm_cmpeq_epi16(cells, stops[3])));
+            uint32_t mask = _mm_movemask_epi8(found);
+            if(mask != 0) {
+                distance += std::countr_zero(mask) / 2;
+                head += distance;
+                return distance;
+            }
+            distance += 8;
+        }
+#endif
+        while(distance < max_distance && !is_stop(tape[head + distance]))
+            ++distance;
+        head += distance;
+    }
+    else {
+        max_distance = std::min<uint64_t>(max_distance, head + 1);
+#ifdef __SSE2__
+        __m128i stops[MAX_SCAN_STOPS];
+        for(size_t i = 0; i < MAX_SCAN_STOPS; ++i)
+            stops[i] = _mm_set1_epi16(scan.stops[i]);
+
+        // Lane 7 holds the cell at the current distance, lower lanes are further away
+        while(distance + 8 <= max_distance) {
+            __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tape + head - distance - 7));
+            __m128i found = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi16(cells, stops[0]), _mm_cmpeq_epi16(cells, stops[1])),
+                _mm_or_si128(_mm_cmpeq_epi16(cells, stops[2]), _mm_cmpeq_epi16(cells, stops[3])));
+            uint32_t mask = _mm_movemask_epi8(found);
+            if(mask != 0) {
+                distance += 7 - (31 - std::countl_zero(mask)) / 2;
+                head -= distance;
+                return distance;
+            }
+            distance += 8;
+        }
+#endif
+        while(distance < max_distance && !is_stop(tape[head - distance]))
+            ++distance;
+        head -= distance;
+    }
+    return distance;
+}
+
+void TuringSimulator::applyMacro(const MacroStep& macro, uint16_t* tape, size_t& head) {
+    const MacroRun* runs = this->tables->macro_runs.data() + macro.first_run;
+    for(uint32_t i = 0; i < macro.num_runs; ++i) {
+        const uint16_t* symbols = this->tables->macro_symbols.data() + runs[i].first_symbol;
+        std::copy(symbols, symbols + runs[i].length, tape + head + runs[i].offset);
+    }
+    head += macro.move;
+}
+
+void TuringSimulator::growTape(size_t tape_index) {
+    std::vector<uint16_t>& tape = this->tapes[tape_index];
+    size_t& head = this->heads[tape_index];
+
+    size_t old_size = tape.size();
+    if(head < old_size)
+        return;
+
+    if(head == old_size) {
+        tape.resize(old_size * 2, 0);
+    }
+    else {
+        // Moved off the left edge, so prepend blank space and shift everything right
+        std::vector<uint16_t> new_tape(old_size * 2, 0);
+        std::copy(tape.begin(), tape.end(), new_tape.begin() + old_size);
+        tape.swap(new_tape);
+        head += old_size;
+    }
+}
+
+void TuringSimulator::reset(const std::vector<uint8_t>& input) {
+    // The input goes on tape 0, any other tape starts out blank
+    this->tapes.assign(this->tables->num_tapes, std::vector<uint16_t>(INITIAL_TAPE_SIZE, 0));
+    this->heads.assign(this->tables->num_tapes, INITIAL_TAPE_SIZE / 4);
+
+    this->tapes[0].assign(std::max(INITIAL_TAPE_SIZE, input.size() * 2), 0);
+    this->heads[0] = this->tapes[0].size() / 4;
+    std::copy(input.begin(), input.end(), this->tapes[0].begin() + this->heads[0]);
+
+    this->state = this->tables->start_state;
+    this->steps = 0;
+    if(this->tables->profile)
+        this->state_hits.assign(this->tables->num_states, 0);
+}
+
+SimulationResult TuringSimulator::run(uint64_t max_steps) {
+    if(this->tables->profile)
+        return this->runProfiled(max_steps);
+    if(this->tables->mapped)
+        return this->runMapped(max_steps);
+    if(this->tables->num_tapes > 1)
+        return this->runTableMulti(max_steps);
+    return this->runTable(max_steps);
+}
+
+SimulationResult TuringSimulator::runTable(uint64_t max_steps) {
+    const JumpEntry* table = this->tables->table.data();
+    const MacroStep* macros = this->tables->macros.data();
+    const ScanLoop* scans = this->tables->scans.data();
+    uint16_t* tape = this->tapes[0].data();
+    size_t tape_size = this->tapes[0].size();
+
+    size_t head = this->heads[0];
+    size_t accept_state = this->tables->accept_state;
+    size_t reject_state = this->tables->reject_state;
+    size_t state = this->state;
+    uint64_t steps = this->steps;
+
+    while(state != accept_state && state != reject_state) {
+        if(steps == max_steps)
+            break;
+
+        // Chains that would run past the step limit or off the tape are single stepped
+        const MacroStep& macro = macros[state];
+        if(macro.length != 0 && max_steps - steps >= macro.length
+                && head + macro.min_offset < tape_size && head + macro.max_offset < tape_size) {
+            this->applyMacro(macro, tape, head);
+            state = macro.next_state;
+            steps += macro.length;
+            continue;
+        }
+
+        const ScanLoop& scan = scans[state];
+        if(scan.num_stops != 0)
+            steps += this->applyScan(scan, tape, tape_size, head, max_steps - steps);
+
+        // A scan ends on a stop symbol unless it ran out of steps or off the tape
+        if(head < tape_size && steps != max_steps) {
+            const JumpEntry& entry = table[state * TAPE_SYMBOLS + tape[head]];
+            tape[head] = entry.output;
+            head += entry.move;
+            state = entry.next_state;
+            ++steps;
+        }
+
+        if(head >= tape_size) {
+            this->heads[0] = head;
+            this->growTape(0);
+            head = this->heads[0];
+            tape = this->tapes[0].data();
+            tape_size = this->tapes[0].size();
+        }
+    }
+
+    this->heads[0] = head;
+    return this->finishRun(state, steps);
+}
+
+SimulationResult TuringSimulator::runTableMulti(uint64_t max_steps) {
+    const JumpEntry* table = this->tables->table.data();
+    const uint8_t* state_tapes = this->tables->state_tapes.data();
+    const MacroStep* macros = this->tables->macros.data();
+    const ScanLoop* scans = this->tables->scans.data();
+    size_t* heads = this->heads.data();
+
+    size_t accept_state = this->tables->accept_state;
+    size_t reject_state = this->tables->reject_state;
+    size_t state = this->state;
+    uint64_t steps = this->steps;
+
+    while(state != accept_state && state != reject_state) {
+        if(steps == max_steps)
+            break;
+
+        size_t tape_index = state_tapes[state];
+        std::vector<uint16_t>& tape = this->tapes[tape_index];
+        size_t& head = heads[tape_index];
+
+        const MacroStep& macro = macros[state];
+        if(macro.length != 0 && max_steps - steps >= macro.length
+                && head + macro.min_offset < tape.size() && head + macro.max_offset < tape.size()) {
+            this->applyMacro(macro, tape.data(), head);
+            state = macro.next_state;
+            steps += macro.length;
+            continue;
+        }
+
+        const ScanLoop& scan = scans[state];
+        if(scan.num_stops != 0)
+            steps += this->applyScan(scan, tape.data(), tape.size(), head, max_steps - steps);
+
+        if(head < tape.size() && steps != max_steps) {
+            const JumpEntry& entry = table[state * TAPE_SYMBOLS + tape[head]];
+            tape[head] = entry.output;
+            head += entry.move;
+            state = entry.next_state;
+            ++steps;
+        }
+
+        if(head >= tape.size())
+            this->growTape(tape_index);
+    }
+
+    return this->finishRun(state, steps);
+}
+
+SimulationResult TuringSimulator::runMapped(uint64_t max_steps) {
+    const TuringState* states = this->tables->mapped->getStates();
+    const PackedTransition* transitions = this->tables->mapped->getTransitionArena();
+    size_t num_states = this->tables->mapped->getNumStates();
+    const MacroStep* macros = this->tables->macros.data();
+    const ScanLoop* scans = this->tables->scans.data();
+    size_t* heads = this->heads.data();
+    const int MOVES[] = {0, -1, 1, 0};
+
+    size_t accept_state = this->tables->accept_state;
+    size_t reject_state = this->tables->reject_state;
+    size_t state = this->state;
+    uint64_t steps = this->steps;
+
+    while(state != accept_state && state != reject_state) {
+        if(steps == max_steps)
+            break;
+
+        const TuringState& info = states[state];
+        const PackedTransition* first = transitions + info.first_transition;
+
+        std::vector<uint16_t>& tape = this->tapes[info.tape];
+        size_t& head = heads[info.tape];
+
+        const MacroStep& macro = macros[state];
+        if(macro.length != 0 && max_steps - steps >= macro.length
+                && head + macro.min_offset < tape.size() && head + macro.max_offset < tape.size()) {
+            this->applyMacro(macro, tape.data(), head);
+            state = macro.next_state;
+            steps += macro.length;
+            continue;
+        }
+
+        const ScanLoop& scan = scans[state];
+        if(scan.num_stops != 0) {
+            steps += this->applyScan(scan, tape.data(), tape.size(), head, max_steps - steps);
+            if(head >= tape.size() || steps == max_steps) {
+                if(head >= tape.size())
+                    this->growTape(info.tape);
+                continue;
+            }
+        }
+
+        uint16_t symbol = tape[head];
+        PackedTransition trans = find_mapped_transition(info, first, symbol);
+        if(trans.next_state >= num_states)
+            throw ProgramException("Transition to unknown state ", trans.next_state, " in state ", state);
+
+        tape[head] = trans.output == PACKED_WILDCARD ? symbol : trans.output;
+        head += MOVES[trans.dir];
+        state = trans.next_state;
+        ++steps;
+
+        if(head >= tape.size())
+            this->growTape(info.tape);
+    }
+
+    return this->finishRun(state, steps);
+}
+
+SimulationResult TuringSimulator::runProfiled(uint64_t max_steps) {
+    // Chains and scans would hide the states they go through, so every step is taken
+    // on its own and counted on the state taking it
+    const SimulatorTables& tables = *this->tables;
+    uint64_t* hits = this->state_hits.data();
+    const int MOVES[] = {0, -1, 1, 0};
+
+    size_t state = this->state;
+    uint64_t steps = this->steps;
+
+    while(state != tables.accept_state && state != tables.reject_state) {
+        if(steps == max_steps)
+            break;
+
+        size_t tape_index;
+        if(tables.mapped)
+            tape_index = tables.mapped->getStates()[state].tape;
+        else
+            tape_index = tables.state_tapes.empty() ? 0 : tables.state_tapes[state];
+
+        std::vector<uint16_t>& tape = this->tapes[tape_index];
+        size_t& head = this->heads[tape_index];
+        uint16_t symbol = tape[head];
+        ++hits[state];
+
+        if(tables.mapped) {
+            const TuringState& info = tables.mapped->getStates()[state];
+            PackedTransition trans = find_mapped_transition(info, tables.mapped->getTransitionArena() + info.first_transition, symbol);
+            if(trans.next_state >= tables.num_states)
+                throw ProgramException("Transition to unknown state ", trans.next_state, " in state ", state);
+
+            tape[head] = trans.output == PACKED_WILDCARD ? symbol : trans.output;
+            head += MOVES[trans.dir];
+            state = trans.next_state;
+        }
+        else {
+            const JumpEntry& entry = tables.table[state * TAPE_SYMBOLS + symbol];
+            tape[head] = entry.output;
+            head += entry.move;
+            state = entry.next_state;
+        }
+        ++steps;
+
+        if(head >= tape.size())
+            this->growTape(tape_index);
+    }
+
+    return this->finishRun(state, steps);
+}
+
+SimulationResult TuringSimulator::finishRun(size_t state, uint64_t steps) {
+    this->state = state;
+    this->steps = steps;
+
+    if(state == this->tables->accept_state)
+        return SimulationResult::ACCEPT;
+    if(state == this->tables->reject_state)
+        return SimulationResult::REJECT;
+    return SimulationResult::TIMEOUT;
+}
+
+uint64_t TuringSimulator::getSteps() const {
+    return this->steps;
+}
+
+size_t TuringSimulator::getNumTapes() const {
+    return this->tables->num_tapes;
+}
+
+size_t TuringSimulator::getHead(size_t tape) const {
+    return this->heads[tape];
+}
+
+const std::vector<uint16_t>& TuringSimulator::getTape(size_t tape) const {
+    return this->tapes[tape];
+}
+
+const std::vector<uint64_t>& TuringSimulator::getStateHits() const {
+    return this->state_hits;
+}
+
+std::vector<uint8_t> read_tape_file(const std::string& path) {
+    std::ifstream tape_file(path, std::ifstream::binary);
+    if(!tape_file)
+        throw ProgramException("Failed to open tape file ", path);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(tape_file), std::istreambuf_iterator<char>());
+}
+
+void print_tape(std::ostream& os, const std::vector<uint16_t>& tape, size_t tape_index) {
+    size_t begin = 0;
+    size_t end = tape.size();
+    while(begin < end && tape[begin] == 0)
+        ++begin;
+    while(end > begin && tape[end - 1] == 0)
+        --end;
+
+    if(tape_index == 0)
+        os << "Tape:";
+    else
+        os << "Tape " << tape_index << ":";
+    for(size_t i = begin; i < end; ++i) {
+        switch(tape[i]) {
+            case TAPE_BP:
+                os << " BP";
+                break;
+            case TAPE_AP:
+                os << " AP";
+                break;
+            case TAPE_TEMP1:
+                os << " TEMP1";
+                break;
+            case TAPE_GP:
+                os << " GP";
+                break;
+            case TAPE_TEMP2:
+                os << " TEMP2";
+                break;
+            default:
+                os << " " << tape[i];
+                break;
+        }
+    }
+    os << std::endl;
+}
+
+std::ostream& operator<<(std::ostream& os, SimulationResult result) {
+    switch(result) {
+        case SimulationResult::ACCEPT:
+            os << "accept";
+            break;
+        case SimulationResult::REJECT:
+            os << "reject";
+            break;
+        case SimulationResult::TIMEOUT:
+            os << "timeout";
+            break;
+    }
+    return os;
+}
\ No newline at end of file
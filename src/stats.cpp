@@ -0,0 +1,75 @@
+#include "stats.hpp"
+
+#include <iostream>
+#include <iomanip>
+
+#include <sys/resource.h>
+
+uint64_t peak_rss_kb() {
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+void CompileStats::startPhase(const std::string& name) {
+    this->current_phase = name;
+    this->phase_start = std::chrono::steady_clock::now();
+}
+
+void CompileStats::endPhase() {
+    auto phase_end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(phase_end - this->phase_start).count();
+    this->phases.push_back({this->current_phase, seconds, peak_rss_kb()});
+}
+
+void CompileStats::print(std::ostream& os) const {
+    os << "Phases:" << std::endl;
+    for(const PhaseStats& phase : this->phases) {
+        os << "  " << std::left << std::setw(12) << phase.name << std::right << std::fixed << std::setprecision(6)
+           << std::setw(12) << phase.seconds << " s" << std::setw(12) << phase.peak_rss_kb << " KB peak" << std::endl;
+    }
+    os << std::defaultfloat;
+
+    os << "Instructions: " << this->num_instrs << std::endl;
+    os << "States: " << this->num_states << std::endl;
+    os << "Transitions: " << this->num_transitions << std::endl;
+    os << "Peak memory: " << peak_rss_kb() << " KB" << std::endl;
+
+    os << "Per opcode (instructions, states, transitions):" << std::endl;
+    for(size_t i = 0; i < this->opcodes.size(); ++i) {
+        const OpcodeStats& op = this->opcodes[i];
+        if(op.instructions == 0)
+            continue;
+        os << "  " << std::left << std::setw(16) << opcode_name(static_cast<Opcode>(i)) << std::right
+           << std::setw(8) << op.instructions << std::setw(12) << op.states << std::setw(12) << op.transitions << std::endl;
+    }
+}
+
+void CompileStats::printJson(std::ostream& os) const {
+    os << "{\"phases\": [";
+    for(size_t i = 0; i < this->phases.size(); ++i) {
+        const PhaseStats& phase = this->phases[i];
+        if(i > 0)
+            os << ", ";
+        os << "{\"name\": \"" << phase.name << "\", \"seconds\": " << phase.seconds << ", \"peak_rss_kb\": " << phase.peak_rss_kb << "}";
+    }
+    os << "], \"instructions\": " << this->num_instrs;
+    os << ", \"states\": " << this->num_states;
+    os << ", \"transitions\": " << this->num_transitions;
+    os << ", \"peak_rss_kb\": " << peak_rss_kb();
+
+    os << ", \"opcodes\": {";
+    bool first = true;
+    for(size_t i = 0; i < this->opcodes.size(); ++i) {
+        const OpcodeStats& op = this->opcodes[i];
+        if(op.instructions == 0)
+            continue;
+        if(!first)
+            os << ", ";
+        first = false;
+        os << "\"" << opcode_name(static_cast<Opcode>(i)) << "\": {\"instructions\": " << op.instructions
+           << ", \"states\": " << op.states << ", \"transitions\": " << op.transitions << "}";
+    }
+    os << "}}" << std::endl;
+}
\ No newline at end of file
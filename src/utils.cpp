@@ -1,5 +1,7 @@
 #include "utils.hpp"
 
+#include <charconv>
+
 std::string utils_ltrim(const std::string& str) {
     size_t i = str.size();
 
@@ -29,4 +31,11 @@ std::vector<std::string> utils_split(const std::string& str, char delim) {
         result.push_back(part);
     }
     return result;
+}
+
+bool utils_parse_uint(const std::string& str, uint64_t& result) {
+    // The whole string has to be a decimal number that fits
+    const char* end = str.data() + str.size();
+    auto parsed = std::from_chars(str.data(), end, result);
+    return !str.empty() && parsed.ec == std::errc() && parsed.ptr == end;
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+# Indexed stores and loads of 8 and 16 bits through the counter lowering. Run with
+# --counter-index=0 --dump-tape; the tape must be the same as with the default
+# table lowering and end on the loaded values without a stray 255 after them:
+# GP 66 66 119 119 0 85 0 0 0 0 0 AP BP 17 17 34 34 66 119 119 17 17 17
+ALLOC 8
+PUSH16 0x4242
+SETGLOBAL16 0
+PUSH16 0x7777
+SETGLOBAL16 2
+PUSH8 0
+MAKEARGS 0
+CALL func
+ACCEPT
+func:
+ENTER
+ALLOC 4
+PUSH16 0x1111
+SETLOCAL16 0
+PUSH8 0x55
+PUSH32 5
+SETGLOBALIND8 0, 8
+PUSH16 0x2222
+PUSH32 2
+SETLOCALIND16 0, 3
+PUSH32 1
+GETGLOBALIND8 0, 4
+PUSH32 2
+GETGLOBALIND16 0, 3
+PUSH32 0
+GETLOCALIND8 0, 4
+PUSH32 0
+GETLOCALIND16 0, 3
+ACCEPT
\ No newline at end of file
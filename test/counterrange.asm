@@ -0,0 +1,8 @@
+# An indexed store past the end of an array. Run with --counter-index=0, with
+# --global-tape and with the default options; the machine must reject like the
+# table lowering does.
+ALLOC 300
+PUSH8 1
+PUSH32 302
+SETGLOBALIND8 0, 300
+ACCEPT
\ No newline at end of file